@@ -0,0 +1,503 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* perf_event_open() needs syscall(), which is not C11 */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "bench.h"
+
+/* Benchmarks the list operations of each list in this directory, and of a
+ * plain dynamic array for comparison, at sizes from 10^3 elements up to a
+ * maximum, by powers of ten. For each it reports nanoseconds and last level
+ * cache misses per operation as CSV on standard out, with progress on
+ * standard error:
+ *
+ *	container,operation,elements,ops,ns_per_op,cache_misses_per_op
+ *
+ * The operations are:
+ *
+ *	append		build the list of n elements by adding to the end
+ *	prepend		add elements to the front of the list of n
+ *	insert		add elements at random positions
+ *	delete		delete elements at random positions
+ *	get_n		find the element at a random position
+ *	traverse	walk the whole list, per element
+ *
+ * Cache misses are counted with perf_event_open(), and left empty if the
+ * kernel does not allow it (see /proc/sys/kernel/perf_event_paranoid).
+ *
+ * usage: bench.bin [maximum elements]
+ */
+
+#define BENCH_MIN_ELEMENTS 1000
+
+/* random position operations are O(n) for most of the lists, so fewer are
+ * done on bigger lists, to keep to roughly this many steps */
+#define BENCH_STEP_BUDGET 10000000
+#define BENCH_MAX_OPS 1000
+#define BENCH_MIN_OPS 10
+
+typedef struct {
+	int perf_fd;		/* -1 if cache misses cannot be counted */
+	double start;
+	const char* container;
+	size_t elements;
+} bench;
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int open_cache_misses(void) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void start(bench* b) {
+	if (b->perf_fd >= 0) {
+		ioctl(b->perf_fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(b->perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	b->start = now();
+}
+
+static void stop(bench* b, const char* operation, size_t ops) {
+	double seconds = now() - b->start;
+	uint64_t misses = 0;
+	bool counted = false;
+
+	if (b->perf_fd >= 0) {
+		ioctl(b->perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+		counted = read(b->perf_fd, &misses, sizeof(misses)) == sizeof(misses);
+	}
+
+	printf("%s,%s,%zu,%zu,%.2f,", b->container, operation, b->elements, ops,
+	       seconds * 1e9 / ops);
+	if (counted) {
+		printf("%.3f", (double) misses / ops);
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+static uint32_t rng_state = 2463534242u;
+
+static size_t random_below(size_t n) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state % n;
+}
+
+/* how many random position operations to do on a list of n */
+static size_t ops_for(size_t n) {
+	size_t ops = BENCH_STEP_BUDGET / n;
+	if (ops > BENCH_MAX_OPS) {
+		ops = BENCH_MAX_OPS;
+	}
+	if (ops < BENCH_MIN_OPS) {
+		ops = BENCH_MIN_OPS;
+	}
+	return ops;
+}
+
+/* how many times to walk a list of n, so that small lists are timed over
+ * long enough to measure */
+static size_t passes_for(size_t n) {
+	return (n < 1000000) ? 1000000 / n : 1;
+}
+
+static volatile long sink;
+
+/* dynamic array */
+
+typedef struct {
+	int* data;
+	size_t length;
+	size_t capacity;
+} array;
+
+static void array_insert(array* a, size_t at, int value) {
+	if (a->length == a->capacity) {
+		a->capacity = (a->capacity > 0) ? a->capacity * 2 : 16;
+		a->data = (int*) realloc(a->data, sizeof(int) * a->capacity);
+	}
+	memmove(&(a->data[at + 1]), &(a->data[at]), sizeof(int) * (a->length - at));
+	a->data[at] = value;
+	a->length++;
+}
+
+static void array_delete(array* a, size_t at) {
+	memmove(&(a->data[at]), &(a->data[at + 1]), sizeof(int) * (a->length - at - 1));
+	a->length--;
+}
+
+static void bench_array(bench* b, size_t n, size_t ops) {
+	array a = {NULL, 0, 0};
+
+	start(b);
+	for (size_t i = 0 ; i < n ; i++) {
+		array_insert(&a, a.length, i);
+	}
+	stop(b, "append", n);
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		array_insert(&a, 0, i);
+	}
+	stop(b, "prepend", ops);
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		array_insert(&a, random_below(a.length), i);
+	}
+	stop(b, "insert", ops);
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		array_delete(&a, random_below(a.length));
+	}
+	stop(b, "delete", ops);
+
+	long sum = 0;
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		sum += a.data[random_below(a.length)];
+	}
+	stop(b, "get_n", ops);
+
+	size_t passes = passes_for(n);
+	start(b);
+	for (size_t p = 0 ; p < passes ; p++) {
+		for (size_t i = 0 ; i < a.length ; i++) {
+			sum += a.data[i];
+		}
+	}
+	stop(b, "traverse", passes * a.length);
+
+	sink = sum;
+	free(a.data);
+}
+
+/* node list, with nodes from malloc() or a pool */
+
+static node* make_int(node_pool* pool, int value) {
+	return (pool != NULL) ? create_node_int_pooled(pool, value) : create_node_int(value);
+}
+
+static void delete_int(node_pool* pool, node* where) {
+	if (pool != NULL) {
+		pool_delete_node(pool, where);
+	} else {
+		free(where->data);
+		delete_node(where);
+	}
+}
+
+static void bench_nodes(bench* b, size_t n, size_t ops, bool pooled) {
+	node_pool* pool = pooled ? create_pool(sizeof(int), 0) : NULL;
+	size_t length = n;
+
+	start(b);
+	node* head = make_int(pool, 0);
+	node* tail = head;
+	for (size_t i = 1 ; i < n ; i++) {
+		node* new = make_int(pool, i);
+		append_node(tail, new);
+		tail = new;
+	}
+	stop(b, "append", n);
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		node* new = make_int(pool, i);
+		prepend_node(new, head);
+		head = new;
+	}
+	stop(b, "prepend", ops);
+	length += ops;
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		append_node(get_n_forward(head, random_below(length)), make_int(pool, i));
+	}
+	stop(b, "insert", ops);
+	length += ops;
+
+	/* never the head, so that it stays valid */
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		delete_int(pool, get_n_forward(head, 1 + random_below(length - 1)));
+		length--;
+	}
+	stop(b, "delete", ops);
+
+	long sum = 0;
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		sum += *((int*) get_n_forward(head, random_below(length))->data);
+	}
+	stop(b, "get_n", ops);
+
+	size_t passes = passes_for(n);
+	start(b);
+	for (size_t p = 0 ; p < passes ; p++) {
+		for (node* cursor = head ; cursor != NULL ; cursor = get_next(cursor)) {
+			sum += *((int*) cursor->data);
+		}
+	}
+	stop(b, "traverse", passes * length);
+
+	sink = sum;
+	if (pool != NULL) {
+		destroy_pool(pool);
+	} else {
+		while (head != NULL) {
+			node* next = get_next(head);
+			free(head->data);
+			free(head);
+			head = next;
+		}
+	}
+}
+
+static void bench_unrolled(bench* b, size_t n, size_t ops) {
+	size_t length = n;
+
+	start(b);
+	unrolled_node* head = create_unrolled(0);
+	unrolled_pos tail = unrolled_first(head);
+	for (size_t i = 1 ; i < n ; i++) {
+		tail = unrolled_append(tail, i);
+	}
+	stop(b, "append", n);
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		unrolled_prepend(unrolled_first(head), i);
+	}
+	stop(b, "prepend", ops);
+	length += ops;
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		unrolled_pos at = unrolled_get_n_forward(unrolled_first(head),
+							 random_below(length));
+		unrolled_append(at, i);
+	}
+	stop(b, "insert", ops);
+	length += ops;
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		unrolled_delete(unrolled_get_n_forward(unrolled_first(head),
+						       random_below(length)));
+		length--;
+	}
+	stop(b, "delete", ops);
+
+	long sum = 0;
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		sum += *unrolled_get(unrolled_get_n_forward(unrolled_first(head),
+							    random_below(length)));
+	}
+	stop(b, "get_n", ops);
+
+	size_t passes = passes_for(n);
+	start(b);
+	for (size_t p = 0 ; p < passes ; p++) {
+		for (unrolled_pos at = unrolled_first(head) ; at.node != NULL ;
+		     at = unrolled_get_next(at)) {
+			sum += *unrolled_get(at);
+		}
+	}
+	stop(b, "traverse", passes * length);
+
+	sink = sum;
+	free_unrolled(head);
+}
+
+static void bench_compact(bench* b, size_t n, size_t ops) {
+	compact_list* list = create_compact_list(0);
+
+	start(b);
+	for (size_t i = 0 ; i < n ; i++) {
+		compact_push_back(list, i);
+	}
+	stop(b, "append", n);
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		compact_prepend_node(list, compact_create_node(list, i), list->head);
+	}
+	stop(b, "prepend", ops);
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		cidx at = compact_get_n_forward(list, list->head, random_below(list->length));
+		compact_append_node(list, at, compact_create_node(list, i));
+	}
+	stop(b, "insert", ops);
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		compact_delete_node(list, compact_get_n_forward(list, list->head,
+					random_below(list->length)));
+	}
+	stop(b, "delete", ops);
+
+	long sum = 0;
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		cidx at = compact_get_n_forward(list, list->head, random_below(list->length));
+		sum += *compact_data(list, at);
+	}
+	stop(b, "get_n", ops);
+
+	size_t passes = passes_for(n);
+	start(b);
+	for (size_t p = 0 ; p < passes ; p++) {
+		for (cidx at = list->head ; at != COMPACT_NIL ; at = compact_get_next(list, at)) {
+			sum += *compact_data(list, at);
+		}
+	}
+	stop(b, "traverse", passes * list->length);
+
+	sink = sum;
+	free_compact_list(list);
+}
+
+static void bench_skiplist(bench* b, size_t n, size_t ops) {
+	skiplist* list = create_skiplist();
+	int value = 0;	/* every element points here, only the shape matters */
+
+	start(b);
+	for (size_t i = 0 ; i < n ; i++) {
+		skiplist_insert_n(list, skiplist_length(list), &value);
+	}
+	stop(b, "append", n);
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		skiplist_insert_n(list, 0, &value);
+	}
+	stop(b, "prepend", ops);
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		skiplist_insert_n(list, random_below(skiplist_length(list) + 1), &value);
+	}
+	stop(b, "insert", ops);
+
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		skiplist_delete_n(list, random_below(skiplist_length(list)));
+	}
+	stop(b, "delete", ops);
+
+	long sum = 0;
+	start(b);
+	for (size_t i = 0 ; i < ops ; i++) {
+		sum += *((int*) skiplist_get_n(list, random_below(skiplist_length(list)))->data);
+	}
+	stop(b, "get_n", ops);
+
+	size_t passes = passes_for(n);
+	start(b);
+	for (size_t p = 0 ; p < passes ; p++) {
+		for (skip_node* at = skiplist_get_n(list, 0) ; at != NULL ; at = skip_get_next(at)) {
+			sum += *((int*) at->data);
+		}
+	}
+	stop(b, "traverse", passes * skiplist_length(list));
+
+	sink = sum;
+	free_skiplist(list);
+}
+
+int main(int argc, char** argv) {
+	size_t max = (argc > 1) ? strtoull(argv[1], NULL, 10) : 1000000;
+
+	if (max < BENCH_MIN_ELEMENTS) {
+		fprintf(stderr, "usage: %s [maximum elements, at least %i]\n",
+			argv[0], BENCH_MIN_ELEMENTS);
+		return 1;
+	}
+
+	bench b;
+	b.perf_fd = open_cache_misses();
+	if (b.perf_fd < 0) {
+		fprintf(stderr, "cannot count cache misses: %s\n", strerror(errno));
+	}
+
+	printf("container,operation,elements,ops,ns_per_op,cache_misses_per_op\n");
+	for (size_t n = BENCH_MIN_ELEMENTS ; n <= max ; n *= 10) {
+		size_t ops = ops_for(n);
+		b.elements = n;
+		fprintf(stderr, "%zu elements\n", n);
+
+		b.container = "array";
+		bench_array(&b, n, ops);
+		b.container = "node";
+		bench_nodes(&b, n, ops, false);
+		b.container = "pooled";
+		bench_nodes(&b, n, ops, true);
+		b.container = "unrolled";
+		bench_unrolled(&b, n, ops);
+		b.container = "compact";
+		bench_compact(&b, n, ops);
+		b.container = "skiplist";
+		bench_skiplist(&b, n, ops);
+	}
+
+	if (b.perf_fd >= 0) {
+		close(b.perf_fd);
+	}
+	return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include "linked_list.h"
+#include "pool.h"
+#include "unrolled.h"
+#include "compact.h"
+#include "skiplist.h"
+
+int main(int argc, char** argv);
+
+#endif
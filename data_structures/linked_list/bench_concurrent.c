@@ -0,0 +1,226 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <threads.h>
+#include <time.h>
+#include "bench_concurrent.h"
+
+/* Compares the throughput of clist against a plain sorted list behind one
+ * mutex, for a read mostly mix of 80% lookups, 10% inserts and 10% deletes
+ * over a fixed range of keys, with 1 to 8 threads.
+ *
+ * usage: bench_concurrent.bin [operations per thread] [key range]
+ */
+
+typedef struct lnode {
+	struct lnode* next;
+	long key;
+	void* data;
+} lnode;
+
+typedef struct {
+	lnode* head;
+	mtx_t lock;
+} locked_list;
+
+static bool locked_insert(locked_list* list, long key, void* data) {
+	mtx_lock(&(list->lock));
+	lnode** prev = &(list->head);
+	while ((*prev != NULL) && ((*prev)->key < key)) {
+		prev = &((*prev)->next);
+	}
+	bool inserted = (*prev == NULL) || ((*prev)->key != key);
+	if (inserted) {
+		lnode* new = (lnode*) malloc(sizeof(lnode));
+		new->key = key;
+		new->data = data;
+		new->next = *prev;
+		*prev = new;
+	}
+	mtx_unlock(&(list->lock));
+	return inserted;
+}
+
+static bool locked_delete(locked_list* list, long key) {
+	mtx_lock(&(list->lock));
+	lnode** prev = &(list->head);
+	while ((*prev != NULL) && ((*prev)->key < key)) {
+		prev = &((*prev)->next);
+	}
+	bool deleted = (*prev != NULL) && ((*prev)->key == key);
+	if (deleted) {
+		lnode* dead = *prev;
+		*prev = dead->next;
+		free(dead);
+	}
+	mtx_unlock(&(list->lock));
+	return deleted;
+}
+
+static void* locked_find(locked_list* list, long key) {
+	void* data = NULL;
+	mtx_lock(&(list->lock));
+	lnode* n = list->head;
+	while ((n != NULL) && (n->key < key)) {
+		n = n->next;
+	}
+	if ((n != NULL) && (n->key == key)) {
+		data = n->data;
+	}
+	mtx_unlock(&(list->lock));
+	return data;
+}
+
+typedef struct {
+	clist* clist;		/* exactly one of these is set */
+	locked_list* locked;
+	int ops;
+	long key_range;
+	unsigned int seed;
+	long found;
+} worker;
+
+static unsigned int next_random(unsigned int* seed) {
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+static int run_worker(void* arg) {
+	worker* w = (worker*) arg;
+	epoch_thread* t = (w->clist != NULL) ? clist_join(w->clist) : NULL;
+
+	for (int i = 0 ; i < w->ops ; i++) {
+		unsigned int r = next_random(&(w->seed));
+		long key = r % w->key_range;
+		int op = (r >> 20) % 10;
+
+		if (w->clist != NULL) {
+			if (op == 0) {
+				clist_insert(w->clist, t, key, w);
+			} else if (op == 1) {
+				clist_delete(w->clist, t, key);
+			} else {
+				w->found += clist_find(w->clist, t, key) != NULL;
+			}
+		} else {
+			if (op == 0) {
+				locked_insert(w->locked, key, w);
+			} else if (op == 1) {
+				locked_delete(w->locked, key);
+			} else {
+				w->found += locked_find(w->locked, key) != NULL;
+			}
+		}
+	}
+
+	if (t != NULL) {
+		clist_leave(w->clist, t);
+	}
+	return 0;
+}
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* runs nthreads workers against whichever list is given, after filling it
+ * half full, and returns operations per second */
+static double run(clist* cl, locked_list* ll, int nthreads, int ops, long key_range) {
+	worker workers[8];
+	thrd_t threads[8];
+
+	for (long key = 0 ; key < key_range ; key += 2) {
+		if (cl != NULL) {
+			epoch_thread* t = clist_join(cl);
+			clist_insert(cl, t, key, NULL);
+			clist_leave(cl, t);
+		} else {
+			locked_insert(ll, key, NULL);
+		}
+	}
+
+	double start = now();
+	for (int i = 0 ; i < nthreads ; i++) {
+		workers[i] = (worker) {
+			.clist = cl,
+			.locked = ll,
+			.ops = ops,
+			.key_range = key_range,
+			.seed = 2463534242u + i * 7919,
+			.found = 0
+		};
+		thrd_create(&(threads[i]), run_worker, &(workers[i]));
+	}
+	for (int i = 0 ; i < nthreads ; i++) {
+		thrd_join(threads[i], NULL);
+	}
+
+	return (double) nthreads * ops / (now() - start);
+}
+
+int main(int argc, char** argv) {
+	int ops = (argc > 1) ? atoi(argv[1]) : 200000;
+	long key_range = (argc > 2) ? atol(argv[2]) : 512;
+
+	if ((ops < 1) || (key_range < 2)) {
+		fprintf(stderr, "usage: %s [operations per thread] [key range]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%i operations per thread, keys 0 to %li, 80%% lookups\n",
+	       ops, key_range - 1);
+	printf("threads    mutex Mops/s    clist Mops/s\n");
+
+	for (int nthreads = 1 ; nthreads <= 8 ; nthreads *= 2) {
+		locked_list ll;
+		ll.head = NULL;
+		mtx_init(&(ll.lock), mtx_plain);
+		double locked_rate = run(NULL, &ll, nthreads, ops, key_range);
+		while (ll.head != NULL) {
+			lnode* next = ll.head->next;
+			free(ll.head);
+			ll.head = next;
+		}
+		mtx_destroy(&(ll.lock));
+
+		clist* cl = create_clist(NULL);
+		double clist_rate = run(cl, NULL, nthreads, ops, key_range);
+		free_clist(cl);
+
+		printf("%7i %15.2f %15.2f\n", nthreads, locked_rate / 1e6, clist_rate / 1e6);
+	}
+
+	return 0;
+}
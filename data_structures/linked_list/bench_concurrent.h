@@ -0,0 +1,9 @@
+#ifndef BENCH_CONCURRENT_H
+#define BENCH_CONCURRENT_H
+
+#include <stdio.h>
+#include "concurrent.h"
+
+int main(int argc, char** argv);
+
+#endif
@@ -0,0 +1,248 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <time.h>
+#include "bench_scan.h"
+
+/* Measures how fast a list of ints can be walked from front to back, summing
+ * the elements, for the plain node list, the pooled node list, an intrusive
+ * list, the unrolled list, the compact list and a plain array.
+ *
+ * usage: bench_scan.bin [elements] [repetitions]
+ */
+
+struct item {
+	LIST_LINK(struct item) link;
+	int value;
+};
+
+LIST_DEFINE(items, struct item, link)
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char* what, long sum, double seconds, int n, int reps) {
+	double per = seconds / ((double) n * reps);
+	printf("%-28s %8.2f ns/element %10.1f M elements/s (sum %li)\n",
+	       what, per * 1e9, 1e-6 / per, sum);
+}
+
+static long scan_nodes(node* head) {
+	long sum = 0;
+	for (node* cursor = head ; cursor != NULL ; cursor = get_next(cursor)) {
+		sum += *((int*) cursor->data);
+	}
+	return sum;
+}
+
+static long scan_items(struct item* head) {
+	long sum = 0;
+	for (struct item* it = head ; it != NULL ; it = items_get_next(it)) {
+		sum += it->value;
+	}
+	return sum;
+}
+
+static long scan_unrolled(unrolled_node* head) {
+	long sum = 0;
+	for (unrolled_node* n = head ; n != NULL ; n = n->next) {
+		for (int i = 0 ; i < n->count ; i++) {
+			sum += n->data[i];
+		}
+	}
+	return sum;
+}
+
+static long scan_compact(compact_list* list) {
+	long sum = 0;
+	for (cidx i = list->head ; i != COMPACT_NIL ; i = compact_get_next(list, i)) {
+		sum += *compact_data(list, i);
+	}
+	return sum;
+}
+
+static long scan_array(int* array, int n) {
+	long sum = 0;
+	for (int i = 0 ; i < n ; i++) {
+		sum += array[i];
+	}
+	return sum;
+}
+
+int main(int argc, char** argv) {
+	int n = (argc > 1) ? atoi(argv[1]) : 1000000;
+	int reps = (argc > 2) ? atoi(argv[2]) : 10;
+	long sum;
+	double start;
+
+	if ((n < 1) || (reps < 1)) {
+		fprintf(stderr, "usage: %s [elements] [repetitions]\n", argv[0]);
+		return 1;
+	}
+
+	printf("scanning %i elements %i times\n", n, reps);
+
+	/* plain list, linked in allocation order */
+	node** nodes = (node**) malloc(sizeof(node*) * n);
+	for (int i = 0 ; i < n ; i++) {
+		nodes[i] = create_node_int(i);
+		if (i > 0) {
+			append_node(nodes[i-1], nodes[i]);
+		}
+	}
+	start = now();
+	for (int r = 0 ; r < reps ; r++) {
+		sum = scan_nodes(nodes[0]);
+	}
+	report("node list", sum, now() - start, n, reps);
+
+	/* the same nodes relinked in a random order, as a list that has been
+	 * edited for a while would be */
+	srand(1);
+	for (int i = n - 1 ; i > 0 ; i--) {
+		int j = rand() % (i + 1);
+		node* tmp = nodes[i];
+		nodes[i] = nodes[j];
+		nodes[j] = tmp;
+	}
+	for (int i = 0 ; i < n ; i++) {
+		nodes[i]->prev = (i > 0) ? nodes[i-1] : NULL;
+		nodes[i]->next = (i < n - 1) ? nodes[i+1] : NULL;
+	}
+	start = now();
+	for (int r = 0 ; r < reps ; r++) {
+		sum = scan_nodes(nodes[0]);
+	}
+	report("node list, shuffled", sum, now() - start, n, reps);
+	for (int i = 0 ; i < n ; i++) {
+		free(nodes[i]->data);
+		free(nodes[i]);
+	}
+	free(nodes);
+
+	node_pool* pool = create_pool(sizeof(int), 0);
+	node* head = create_node_int_pooled(pool, 0);
+	node* last = head;
+	for (int i = 1 ; i < n ; i++) {
+		node* new = create_node_int_pooled(pool, i);
+		append_node(last, new);
+		last = new;
+	}
+	start = now();
+	for (int r = 0 ; r < reps ; r++) {
+		sum = scan_nodes(head);
+	}
+	report("pooled node list", sum, now() - start, n, reps);
+	destroy_pool(pool);
+
+	struct item* elements = (struct item*) malloc(sizeof(struct item) * n);
+	for (int i = 0 ; i < n ; i++) {
+		elements[i].value = i;
+		items_init_node(&(elements[i]));
+		if (i > 0) {
+			items_append_node(&(elements[i-1]), &(elements[i]));
+		}
+	}
+	start = now();
+	for (int r = 0 ; r < reps ; r++) {
+		sum = scan_items(&(elements[0]));
+	}
+	report("intrusive list", sum, now() - start, n, reps);
+	free(elements);
+
+	unrolled_node* uhead = create_unrolled(0);
+	unrolled_pos pos = unrolled_first(uhead);
+	for (int i = 1 ; i < n ; i++) {
+		pos = unrolled_append(pos, i);
+	}
+	start = now();
+	for (int r = 0 ; r < reps ; r++) {
+		sum = scan_unrolled(uhead);
+	}
+	report("unrolled list", sum, now() - start, n, reps);
+	free_unrolled(uhead);
+
+	compact_list* clist = create_compact_list(n);
+	for (int i = 0 ; i < n ; i++) {
+		compact_push_back(clist, i);
+	}
+	start = now();
+	for (int r = 0 ; r < reps ; r++) {
+		sum = scan_compact(clist);
+	}
+	report("compact list", sum, now() - start, n, reps);
+
+	/* relink in a random order, then lay it out again */
+	cidx* order = (cidx*) malloc(sizeof(cidx) * n);
+	for (int i = 0 ; i < n ; i++) {
+		order[i] = i;
+	}
+	for (int i = n - 1 ; i > 0 ; i--) {
+		int j = rand() % (i + 1);
+		cidx tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	for (int i = 0 ; i < n ; i++) {
+		clist->nodes[order[i]].prev = (i > 0) ? order[i-1] : COMPACT_NIL;
+		clist->nodes[order[i]].next = (i < n - 1) ? order[i+1] : COMPACT_NIL;
+	}
+	clist->head = order[0];
+	clist->tail = order[n-1];
+	free(order);
+	start = now();
+	for (int r = 0 ; r < reps ; r++) {
+		sum = scan_compact(clist);
+	}
+	report("compact list, shuffled", sum, now() - start, n, reps);
+	compact_relayout(clist, NULL);
+	start = now();
+	for (int r = 0 ; r < reps ; r++) {
+		sum = scan_compact(clist);
+	}
+	report("compact list, relaid", sum, now() - start, n, reps);
+	free_compact_list(clist);
+
+	int* array = (int*) malloc(sizeof(int) * n);
+	for (int i = 0 ; i < n ; i++) {
+		array[i] = i;
+	}
+	start = now();
+	for (int r = 0 ; r < reps ; r++) {
+		sum = scan_array(array, n);
+	}
+	report("array", sum, now() - start, n, reps);
+	free(array);
+
+	return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef BENCH_SCAN_H
+#define BENCH_SCAN_H
+
+#include <stdio.h>
+#include "linked_list.h"
+#include "pool.h"
+#include "unrolled.h"
+#include "intrusive.h"
+#include "compact.h"
+
+int main(int argc, char** argv);
+
+#endif
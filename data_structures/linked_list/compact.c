@@ -0,0 +1,210 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "compact.h"
+
+/* Index linked list in a single array */
+
+#define COMPACT_DEFAULT_CAPACITY 64
+
+compact_list* create_compact_list(cidx capacity) {
+	compact_list* list = (compact_list*) malloc(sizeof(compact_list));
+	list->capacity = (capacity > 0) ? capacity : COMPACT_DEFAULT_CAPACITY;
+	list->nodes = (compact_node*) malloc(sizeof(compact_node) * list->capacity);
+	list->used = 0;
+	list->length = 0;
+	list->free_slots = COMPACT_NIL;
+	list->head = COMPACT_NIL;
+	list->tail = COMPACT_NIL;
+	return list;
+}
+
+void free_compact_list(compact_list* list) {
+	free(list->nodes);
+	free(list);
+}
+
+cidx compact_create_node(compact_list* list, compact_elem data) {
+	cidx i;
+
+	if (list->free_slots != COMPACT_NIL) {
+		i = list->free_slots;
+		list->free_slots = list->nodes[i].next;
+	} else {
+		if (list->used == list->capacity) {
+			/* one slot short of the maximum, which is COMPACT_NIL */
+			cidx max = COMPACT_NIL - 1;
+			if (list->capacity == max) {
+				fprintf(stderr, "compact list is full\n");
+				exit(1);
+			}
+			list->capacity = (list->capacity > max / 2) ? max : list->capacity * 2;
+			list->nodes = (compact_node*) realloc(list->nodes,
+					sizeof(compact_node) * list->capacity);
+		}
+		i = list->used++;
+	}
+
+	list->nodes[i].prev = COMPACT_NIL;
+	list->nodes[i].next = COMPACT_NIL;
+	list->nodes[i].data = data;
+	return i;
+}
+
+compact_elem* compact_data(compact_list* list, cidx where) {
+	return &(list->nodes[where].data);
+}
+
+void compact_insert_node(compact_list* list, cidx prev, cidx new, cidx next) {
+	compact_node* n = list->nodes;
+
+	n[prev].next = new;
+	n[new].prev = prev;
+
+	n[next].prev = new;
+	n[new].next = next;
+
+	list->length++;
+}
+
+/* links new in as the only node, if the list is empty */
+static void link_first(compact_list* list, cidx new) {
+	list->head = new;
+	list->tail = new;
+	list->length = 1;
+}
+
+void compact_append_node(compact_list* list, cidx where, cidx new) {
+	compact_node* n = list->nodes;
+
+	if (list->length == 0) {
+		link_first(list, new);
+	} else if (n[where].next == COMPACT_NIL) {
+		n[where].next = new;
+		n[new].prev = where;
+		list->tail = new;
+		list->length++;
+	} else {
+		compact_insert_node(list, where, new, n[where].next);
+	}
+}
+
+void compact_prepend_node(compact_list* list, cidx new, cidx where) {
+	compact_node* n = list->nodes;
+
+	if (list->length == 0) {
+		link_first(list, new);
+	} else if (n[where].prev == COMPACT_NIL) {
+		n[where].prev = new;
+		n[new].next = where;
+		list->head = new;
+		list->length++;
+	} else {
+		compact_insert_node(list, n[where].prev, new, where);
+	}
+}
+
+void compact_delete_node(compact_list* list, cidx where) {
+	compact_node* n = list->nodes;
+	cidx prev = n[where].prev;
+	cidx next = n[where].next;
+
+	if (prev != COMPACT_NIL) {
+		n[prev].next = next;
+	} else {
+		list->head = next;
+	}
+	if (next != COMPACT_NIL) {
+		n[next].prev = prev;
+	} else {
+		list->tail = prev;
+	}
+	list->length--;
+
+	n[where].prev = COMPACT_NIL;
+	n[where].next = list->free_slots;
+	list->free_slots = where;
+}
+
+cidx compact_get_next(compact_list* list, cidx where) {
+	return list->nodes[where].next;
+}
+
+cidx compact_get_prev(compact_list* list, cidx where) {
+	return list->nodes[where].prev;
+}
+
+cidx compact_get_n_forward(compact_list* list, cidx where, int n) {
+	for ( ; (n > 0) && (where != COMPACT_NIL) ; n--) {
+		where = list->nodes[where].next;
+	}
+	return where;
+}
+
+cidx compact_get_n_back(compact_list* list, cidx where, int n) {
+	for ( ; (n > 0) && (where != COMPACT_NIL) ; n--) {
+		where = list->nodes[where].prev;
+	}
+	return where;
+}
+
+cidx compact_push_back(compact_list* list, compact_elem data) {
+	cidx new = compact_create_node(list, data);
+	compact_append_node(list, list->tail, new);
+	return new;
+}
+
+void compact_relayout(compact_list* list, cidx* remap) {
+	compact_node* old = list->nodes;
+	compact_node* laid = (compact_node*) malloc(sizeof(compact_node) * list->capacity);
+
+	if (remap != NULL) {
+		for (cidx i = 0 ; i < list->used ; i++) {
+			remap[i] = COMPACT_NIL;
+		}
+	}
+
+	cidx i = 0;
+	for (cidx at = list->head ; at != COMPACT_NIL ; at = old[at].next, i++) {
+		laid[i].prev = (i > 0) ? i - 1 : COMPACT_NIL;
+		laid[i].next = (i + 1 < list->length) ? i + 1 : COMPACT_NIL;
+		laid[i].data = old[at].data;
+		if (remap != NULL) {
+			remap[at] = i;
+		}
+	}
+
+	free(old);
+	list->nodes = laid;
+	list->used = list->length;
+	list->free_slots = COMPACT_NIL;
+	list->head = (list->length > 0) ? 0 : COMPACT_NIL;
+	list->tail = (list->length > 0) ? list->length - 1 : COMPACT_NIL;
+}
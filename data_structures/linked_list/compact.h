@@ -0,0 +1,65 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* A list whose nodes all live in one growable array and link to each other
+ * by 32 bit index rather than by pointer, with the payload stored inline. An
+ * int element costs 12 bytes, against a node, its malloc() overhead and a
+ * boxed int for the plain list. Deleted slots are reused, and
+ * compact_relayout() moves the nodes back into list order, so that walking
+ * the list walks the array. */
+
+typedef int compact_elem;
+typedef uint32_t cidx;
+
+/* the index version of NULL */
+#define COMPACT_NIL UINT32_MAX
+
+typedef struct {
+	cidx prev;
+	cidx next;
+	compact_elem data;
+} compact_node;
+
+typedef struct {
+	compact_node* nodes;
+	cidx capacity;
+	cidx used;		/* slots below this have been handed out */
+	cidx length;		/* nodes in the list */
+	cidx free_slots;	/* deleted slots, linked through next */
+	cidx head;
+	cidx tail;
+} compact_list;
+
+/* capacity is only a starting point, 0 picks a default */
+compact_list* create_compact_list(cidx capacity);
+void free_compact_list(compact_list* list);
+
+/* makes a node that is not yet linked into the list. Indices stay valid as
+ * the array grows, until the node is deleted or the list relaid. */
+cidx compact_create_node(compact_list* list, compact_elem data);
+compact_elem* compact_data(compact_list* list, cidx where);
+
+/* the same operations as linked_list.h, with indices for nodes */
+void compact_insert_node(compact_list* list, cidx prev, cidx new, cidx next);
+void compact_append_node(compact_list* list, cidx where, cidx new);
+void compact_prepend_node(compact_list* list, cidx new, cidx where);
+void compact_delete_node(compact_list* list, cidx where);
+cidx compact_get_next(compact_list* list, cidx where);
+cidx compact_get_prev(compact_list* list, cidx where);
+cidx compact_get_n_forward(compact_list* list, cidx where, int n);
+cidx compact_get_n_back(compact_list* list, cidx where, int n);
+
+/* creates a node and links it in at the end, returning it */
+cidx compact_push_back(compact_list* list, compact_elem data);
+
+/* Moves every node so that the list runs through the array in order from
+ * slot 0, and drops the free slots. Every index changes, if remap is not
+ * NULL it is filled in with the new index of each old one (COMPACT_NIL for
+ * slots that were free), and must have room for list->used entries. */
+void compact_relayout(compact_list* list, cidx* remap);
+
+#endif
@@ -0,0 +1,221 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include "concurrent.h"
+
+/* Lock free sorted list. Deleting a node first marks its next pointer, which
+ * stops anything being inserted after it, and then unlinks it. Any thread
+ * that finds a marked node on its way through the list helps by unlinking
+ * it, so a delete never has to wait for anyone. */
+
+#define MARK ((uintptr_t) 1)
+#define marked(_p) (((_p) & MARK) != 0)
+#define unmarked(_p) ((cnode*) ((_p) & ~MARK))
+
+clist* create_clist(void (*free_data)(void*)) {
+	clist* list = (clist*) malloc(sizeof(clist));
+	atomic_init(&(list->head.next), (uintptr_t) NULL);
+	list->head.key = 0;
+	list->head.data = NULL;
+	init_epoch_domain(&(list->epochs));
+	list->free_data = free_data;
+	return list;
+}
+
+static void free_cnode(void* ptr, void* ctx) {
+	clist* list = (clist*) ctx;
+	cnode* n = (cnode*) ptr;
+	if (list->free_data != NULL) {
+		list->free_data(n->data);
+	}
+	free(n);
+}
+
+void free_clist(clist* list) {
+	cnode* n = unmarked(atomic_load(&(list->head.next)));
+	while (n != NULL) {
+		cnode* next = unmarked(atomic_load(&(n->next)));
+		free_cnode(n, list);
+		n = next;
+	}
+	destroy_epoch_domain(&(list->epochs));
+	free(list);
+}
+
+epoch_thread* clist_join(clist* list) {
+	return epoch_join(&(list->epochs));
+}
+
+void clist_leave(clist* list, epoch_thread* t) {
+	epoch_leave(&(list->epochs), t);
+}
+
+void clist_enter(clist* list, epoch_thread* t) {
+	epoch_enter(&(list->epochs), t);
+}
+
+void clist_exit(clist* list, epoch_thread* t) {
+	epoch_exit(&(list->epochs), t);
+}
+
+/* Finds the first node with a key of at least key, unlinking any deleted
+ * nodes on the way. On return *prev is the link that points to it, and the
+ * result says whether its key is equal. Must be called inside an epoch
+ * bracket. */
+static bool find(clist* list, epoch_thread* t, long key,
+		 _Atomic(uintptr_t)** prev_out, cnode** curr_out) {
+retry:
+	;
+	_Atomic(uintptr_t)* prev = &(list->head.next);
+	cnode* curr = unmarked(atomic_load(prev));
+
+	while (curr != NULL) {
+		uintptr_t next = atomic_load(&(curr->next));
+
+		if (marked(next)) {
+			uintptr_t expected = (uintptr_t) curr;
+			if (!atomic_compare_exchange_strong(prev, &expected,
+						(uintptr_t) unmarked(next))) {
+				goto retry;
+			}
+			epoch_retire(&(list->epochs), t, curr, free_cnode, list);
+			curr = unmarked(next);
+			continue;
+		}
+
+		if (curr->key >= key) {
+			*prev_out = prev;
+			*curr_out = curr;
+			return curr->key == key;
+		}
+
+		prev = &(curr->next);
+		curr = unmarked(next);
+	}
+
+	*prev_out = prev;
+	*curr_out = NULL;
+	return false;
+}
+
+bool clist_insert(clist* list, epoch_thread* t, long key, void* data) {
+	_Atomic(uintptr_t)* prev;
+	cnode* curr;
+	cnode* new = (cnode*) malloc(sizeof(cnode));
+	new->key = key;
+	new->data = data;
+
+	epoch_enter(&(list->epochs), t);
+	for (;;) {
+		if (find(list, t, key, &prev, &curr)) {
+			epoch_exit(&(list->epochs), t);
+			free(new);
+			return false;
+		}
+
+		atomic_store_explicit(&(new->next), (uintptr_t) curr, memory_order_relaxed);
+		uintptr_t expected = (uintptr_t) curr;
+		if (atomic_compare_exchange_strong(prev, &expected, (uintptr_t) new)) {
+			epoch_exit(&(list->epochs), t);
+			return true;
+		}
+	}
+}
+
+bool clist_delete(clist* list, epoch_thread* t, long key) {
+	_Atomic(uintptr_t)* prev;
+	cnode* curr;
+
+	epoch_enter(&(list->epochs), t);
+	for (;;) {
+		if (!find(list, t, key, &prev, &curr)) {
+			epoch_exit(&(list->epochs), t);
+			return false;
+		}
+
+		/* logically delete curr by marking its next pointer. If it is
+		 * already marked, someone else got there first, and the next
+		 * find() will say so. */
+		uintptr_t next = atomic_load(&(curr->next));
+		if (marked(next)) {
+			continue;
+		}
+		if (!atomic_compare_exchange_strong(&(curr->next), &next, next | MARK)) {
+			continue;
+		}
+
+		/* then try to unlink it, leaving it to a later find() if the
+		 * list changed under us */
+		uintptr_t expected = (uintptr_t) curr;
+		if (atomic_compare_exchange_strong(prev, &expected, next)) {
+			epoch_retire(&(list->epochs), t, curr, free_cnode, list);
+		} else {
+			find(list, t, key, &prev, &curr);
+		}
+		epoch_exit(&(list->epochs), t);
+		return true;
+	}
+}
+
+void* clist_find(clist* list, epoch_thread* t, long key) {
+	void* data = NULL;
+
+	/* readers never unlink, so they do not need to retry */
+	epoch_enter(&(list->epochs), t);
+	cnode* curr = unmarked(atomic_load(&(list->head.next)));
+	while ((curr != NULL) && (curr->key < key)) {
+		curr = unmarked(atomic_load(&(curr->next)));
+	}
+	if ((curr != NULL) && (curr->key == key) &&
+	    !marked(atomic_load(&(curr->next)))) {
+		data = curr->data;
+	}
+	epoch_exit(&(list->epochs), t);
+
+	return data;
+}
+
+size_t clist_length(clist* list, epoch_thread* t) {
+	size_t length = 0;
+
+	epoch_enter(&(list->epochs), t);
+	cnode* curr = unmarked(atomic_load(&(list->head.next)));
+	while (curr != NULL) {
+		uintptr_t next = atomic_load(&(curr->next));
+		if (!marked(next)) {
+			length++;
+		}
+		curr = unmarked(next);
+	}
+	epoch_exit(&(list->epochs), t);
+
+	return length;
+}
@@ -0,0 +1,59 @@
+#ifndef CONCURRENT_H
+#define CONCURRENT_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "epoch.h"
+
+/* A lock free list that any number of threads can insert into, delete from
+ * and search at the same time (Harris, "A Pragmatic Implementation of
+ * Non-Blocking Linked-Lists", 2001, with Michael's changes for safe memory
+ * reclamation). Elements are kept sorted by a key, and each key appears at
+ * most once. Nodes are freed through epoch based reclamation (see epoch.h),
+ * so a deleted node, and its data, stay valid for as long as another thread
+ * might still be reading them. */
+
+typedef struct cnode {
+	/* the low bit is set once this node has been deleted */
+	_Atomic(uintptr_t) next;
+	long key;
+	void* data;
+} cnode;
+
+typedef struct {
+	cnode head;		/* sentinel, never deleted */
+	epoch_domain epochs;
+	void (*free_data)(void*);
+} clist;
+
+/* free_data is called on the data of each node as it is freed, NULL to leave
+ * data alone */
+clist* create_clist(void (*free_data)(void*));
+
+/* no other thread may be using the list */
+void free_clist(clist* list);
+
+/* every thread using the list must join it first, and use the epoch_thread
+ * it gets back for every call. Returns NULL if EPOCH_MAX_THREADS threads
+ * have already joined. */
+epoch_thread* clist_join(clist* list);
+void clist_leave(clist* list, epoch_thread* t);
+
+/* false if key is already in the list */
+bool clist_insert(clist* list, epoch_thread* t, long key, void* data);
+
+/* false if key is not in the list */
+bool clist_delete(clist* list, epoch_thread* t, long key);
+
+/* Returns the data for key, or NULL if it is not in the list. The data may be
+ * freed as soon as the call returns, unless the caller surrounds both the
+ * call and its use of the data with clist_enter()/clist_exit(). */
+void* clist_find(clist* list, epoch_thread* t, long key);
+void clist_enter(clist* list, epoch_thread* t);
+void clist_exit(clist* list, epoch_thread* t);
+
+/* number of elements, only exact if no other thread is changing the list */
+size_t clist_length(clist* list, epoch_thread* t);
+
+#endif
@@ -30,10 +30,19 @@
 
 #include "demo.h"
 
+struct item {
+	int value;
+	LIST_LINK(struct item) link;
+};
+
+LIST_DEFINE(items, struct item, link)
+
 int main() {
 	node* head = create_node_int(0);
 	node* last = head;
-	printf("created head node: %s\n", sprint_node_int(head));
+	printf("created head node: ");
+	fprint_node_int(stdout, head);
+	printf("\n");
 
 	for (int i = 1 ; i < 10 ; i ++) {
 		node* new;
@@ -47,12 +56,15 @@ int main() {
 
 	node* cursor = head;
 	while (cursor != NULL) {
-		printf("%s\n", sprint_node_int(cursor));
+		fprint_node_int(stdout, cursor);
+		printf("\n");
 		cursor = get_next(cursor);
 	}
 
 	cursor = get_n_forward(head, 5);
-	printf("The 5th node is: %s\n", sprint_node_int(cursor));
+	printf("The 5th node is: ");
+	fprint_node_int(stdout, cursor);
+	printf("\n");
 	printf("Deleting the 5th node... \n");
 	delete_node(cursor);
 
@@ -60,9 +72,123 @@ int main() {
 
 	cursor = head;
 	while (cursor != NULL) {
-		printf("%s\n", sprint_node_int(cursor));
+		fprint_node_int(stdout, cursor);
+		printf("\n");
+		cursor = get_next(cursor);
+	}
+
+	printf("Building the same list from a pool... \n");
+	node_pool* pool = create_pool(sizeof(int), 0);
+	head = create_node_int_pooled(pool, 0);
+	last = head;
+	for (int i = 1 ; i < 10 ; i ++) {
+		node* new = create_node_int_pooled(pool, i);
+		append_node(last, new);
+		last = new;
+	}
+
+	cursor = get_n_forward(head, 5);
+	printf("Deleting the 5th node and inserting 10 in its place... \n");
+	node* prev = get_prev(cursor);
+	pool_delete_node(pool, cursor);
+	append_node(prev, create_node_int_pooled(pool, 10));
+
+	printf("List state is: \n");
+
+	cursor = head;
+	while (cursor != NULL) {
+		fprint_node_int(stdout, cursor);
+		printf("\n");
 		cursor = get_next(cursor);
 	}
 
+	printf("Saving the list to demo.list and loading it into a new pool... \n");
+	if (save_list_int(head, "demo.list") != 0) {
+		perror("demo.list");
+		return 1;
+	}
+	node_pool* loaded_pool = create_pool(sizeof(int), 0);
+	node* loaded = load_list("demo.list", loaded_pool);
+	printf("Loaded list state is: \n");
+	for (cursor = loaded ; cursor != NULL ; cursor = get_next(cursor)) {
+		printf("%i ", *((int*) cursor->data));
+	}
+	printf("\n");
+	destroy_pool(loaded_pool);
+
+	printf("Destroying the pool, and so the whole list... \n");
+	destroy_pool(pool);
+
+	printf("Building a skip list of the same ints... \n");
+	int values[11];
+	skiplist* list = create_skiplist();
+	for (int i = 0 ; i < 11 ; i ++) {
+		values[i] = i;
+		skiplist_insert_n(list, i < 10 ? i : 2, &(values[i]));
+	}
+	printf("Inserted 10 at index 2, deleting index 5 (%i)... \n",
+	       *((int*) skiplist_delete_n(list, 5)));
+	printf("Skip list state is: \n");
+	for (skip_node* s = skiplist_get_n(list, 0) ; s != NULL ; s = skip_get_next(s)) {
+		printf("%i ", *((int*) s->data));
+	}
+	printf("\nThe 7th element is %i\n", *((int*) skiplist_get_n(list, 7)->data));
+	free_skiplist(list);
+
+	printf("Building an intrusive list of the same ints... \n");
+	struct item elements[10];
+	for (int i = 0 ; i < 10 ; i ++) {
+		elements[i].value = i;
+		items_init_node(&(elements[i]));
+		if (i > 0) {
+			items_append_node(&(elements[i-1]), &(elements[i]));
+		}
+	}
+	struct item* fifth = items_get_n_forward(&(elements[0]), 5);
+	printf("Deleting the 5th element (%i)... \n", fifth->value);
+	items_delete_node(fifth);
+	printf("Intrusive list state is: \n");
+	for (struct item* it = &(elements[0]) ; it != NULL ; it = items_get_next(it)) {
+		printf("%i ", it->value);
+	}
+	printf("\n");
+
+	int unsorted[10] = {7, 3, 9, 0, 5, 1, 8, 2, 6, 4};
+	int more[3] = {-1, -2, -3};
+	int sorted[13];
+	printf("Building a list from an array and sorting it... \n");
+	head = sort_list(build_list_int(unsorted, 10), compare_int);
+	node* extra = build_list_int(more, 3);
+	printf("Splicing in a list of 3 after the 5th node... \n");
+	splice_nodes(get_n_forward(head, 5), extra, get_n_forward(extra, 2));
+	size_t count = flatten_list_int(head, sorted, 13);
+	printf("Flattened back into an array: \n");
+	for (size_t i = 0 ; i < count ; i++) {
+		printf("%i ", sorted[i]);
+	}
+	printf("\n");
+
+	printf("Building a compact list of the same ints... \n");
+	compact_list* compact = create_compact_list(0);
+	for (int i = 0 ; i < 10 ; i ++) {
+		compact_push_back(compact, i);
+	}
+	cidx at = compact_get_n_forward(compact, compact->head, 5);
+	printf("Deleting the 5th node (slot %u) and prepending 10 to the list... \n", at);
+	compact_delete_node(compact, at);
+	at = compact_create_node(compact, 10);
+	compact_prepend_node(compact, at, compact->head);
+	printf("10 reused slot %u, compact list state is: \n", at);
+	for (cidx i = compact->head ; i != COMPACT_NIL ; i = compact_get_next(compact, i)) {
+		printf("%i@%u ", *compact_data(compact, i), i);
+	}
+	compact_relayout(compact, NULL);
+	printf("\nAfter relaying out: \n");
+	for (cidx i = compact->head ; i != COMPACT_NIL ; i = compact_get_next(compact, i)) {
+		printf("%i@%u ", *compact_data(compact, i), i);
+	}
+	printf("\n");
+	free_compact_list(compact);
+
 	return 0;
 }
@@ -3,6 +3,12 @@
 
 #include <stdio.h>
 #include "linked_list.h"
+#include "pool.h"
+#include "skiplist.h"
+#include "intrusive.h"
+#include "sort.h"
+#include "compact.h"
+#include "serialize.h"
 
 int main();
 
@@ -0,0 +1,188 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include "epoch.h"
+
+/* Epoch based reclamation, in the style of crossbeam-epoch. An object
+ * retired in epoch e is unlinked before it is retired, so only threads that
+ * entered in epoch e or earlier can hold it. The epoch only advances when
+ * every thread inside a bracket has seen the current one, so once it reaches
+ * e + 2 all of those threads have left and the object can be freed. */
+
+#define PINNED 1ul
+
+void init_epoch_domain(epoch_domain* d) {
+	atomic_init(&(d->epoch), 0);
+	for (int i = 0 ; i < EPOCH_MAX_THREADS ; i++) {
+		epoch_thread* t = &(d->threads[i]);
+		atomic_init(&(t->local), 0);
+		atomic_init(&(t->in_use), false);
+		t->nesting = 0;
+		t->retired = NULL;
+		t->nretired = 0;
+		t->capacity = 0;
+		t->since_collect = 0;
+	}
+	mtx_init(&(d->orphans_lock), mtx_plain);
+	d->orphans = NULL;
+	d->norphans = 0;
+}
+
+static void free_all(epoch_retired* r, size_t n) {
+	for (size_t i = 0 ; i < n ; i++) {
+		r[i].free_fn(r[i].ptr, r[i].ctx);
+	}
+}
+
+void destroy_epoch_domain(epoch_domain* d) {
+	for (int i = 0 ; i < EPOCH_MAX_THREADS ; i++) {
+		epoch_thread* t = &(d->threads[i]);
+		free_all(t->retired, t->nretired);
+		free(t->retired);
+	}
+	free_all(d->orphans, d->norphans);
+	free(d->orphans);
+	mtx_destroy(&(d->orphans_lock));
+}
+
+epoch_thread* epoch_join(epoch_domain* d) {
+	for (int i = 0 ; i < EPOCH_MAX_THREADS ; i++) {
+		bool expected = false;
+		epoch_thread* t = &(d->threads[i]);
+		if (atomic_compare_exchange_strong(&(t->in_use), &expected, true)) {
+			t->nesting = 0;
+			t->since_collect = 0;
+			return t;
+		}
+	}
+	return NULL;
+}
+
+void epoch_enter(epoch_domain* d, epoch_thread* t) {
+	if (t->nesting++ > 0) {
+		return;
+	}
+	unsigned long e = atomic_load_explicit(&(d->epoch), memory_order_relaxed);
+	atomic_store_explicit(&(t->local), (e << 1) | PINNED, memory_order_relaxed);
+	/* the pin must be visible before anything in the bracket is read */
+	atomic_thread_fence(memory_order_seq_cst);
+}
+
+void epoch_exit(epoch_domain* d, epoch_thread* t) {
+	(void) d;
+	if (--t->nesting > 0) {
+		return;
+	}
+	atomic_store_explicit(&(t->local), 0, memory_order_release);
+}
+
+/* moves the global epoch on by one if every pinned thread has seen it, and
+ * returns the global epoch */
+static unsigned long try_advance(epoch_domain* d) {
+	unsigned long e = atomic_load(&(d->epoch));
+	for (int i = 0 ; i < EPOCH_MAX_THREADS ; i++) {
+		epoch_thread* t = &(d->threads[i]);
+		if (!atomic_load_explicit(&(t->in_use), memory_order_relaxed)) {
+			continue;
+		}
+		unsigned long local = atomic_load(&(t->local));
+		if ((local & PINNED) && ((local >> 1) != e)) {
+			return e;
+		}
+	}
+	atomic_compare_exchange_strong(&(d->epoch), &e, e + 1);
+	return atomic_load(&(d->epoch));
+}
+
+/* frees the entries of r that are old enough, keeping the rest, and returns
+ * how many are kept */
+static size_t collect(epoch_retired* r, size_t n, unsigned long epoch) {
+	size_t kept = 0;
+	for (size_t i = 0 ; i < n ; i++) {
+		if (r[i].epoch + 2 <= epoch) {
+			r[i].free_fn(r[i].ptr, r[i].ctx);
+		} else {
+			r[kept++] = r[i];
+		}
+	}
+	return kept;
+}
+
+static void collect_all(epoch_domain* d, epoch_thread* t) {
+	unsigned long epoch = try_advance(d);
+	t->nretired = collect(t->retired, t->nretired, epoch);
+
+	if (mtx_trylock(&(d->orphans_lock)) == thrd_success) {
+		d->norphans = collect(d->orphans, d->norphans, epoch);
+		mtx_unlock(&(d->orphans_lock));
+	}
+}
+
+void epoch_retire(epoch_domain* d, epoch_thread* t, void* ptr,
+		  epoch_free_fn free_fn, void* ctx) {
+	if (t->nretired == t->capacity) {
+		t->capacity = (t->capacity > 0) ? t->capacity * 2 : EPOCH_COLLECT_EVERY;
+		t->retired = (epoch_retired*) realloc(t->retired,
+				sizeof(epoch_retired) * t->capacity);
+	}
+
+	epoch_retired* r = &(t->retired[t->nretired++]);
+	r->ptr = ptr;
+	r->free_fn = free_fn;
+	r->ctx = ctx;
+	r->epoch = atomic_load(&(d->epoch));
+
+	if (++t->since_collect >= EPOCH_COLLECT_EVERY) {
+		t->since_collect = 0;
+		collect_all(d, t);
+	}
+}
+
+void epoch_leave(epoch_domain* d, epoch_thread* t) {
+	collect_all(d, t);
+
+	/* anything still too new is handed to the domain */
+	if (t->nretired > 0) {
+		mtx_lock(&(d->orphans_lock));
+		d->orphans = (epoch_retired*) realloc(d->orphans,
+				sizeof(epoch_retired) * (d->norphans + t->nretired));
+		for (size_t i = 0 ; i < t->nretired ; i++) {
+			d->orphans[d->norphans++] = t->retired[i];
+		}
+		mtx_unlock(&(d->orphans_lock));
+	}
+
+	free(t->retired);
+	t->retired = NULL;
+	t->nretired = 0;
+	t->capacity = 0;
+	atomic_store(&(t->in_use), false);
+}
@@ -0,0 +1,74 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <threads.h>
+
+/* Epoch based reclamation, for lock free structures where one thread may
+ * unlink memory that another thread is still reading (Fraser, "Practical
+ * lock-freedom", 2004).
+ *
+ * Readers and writers bracket every access with epoch_enter() and
+ * epoch_exit(). Memory that has been unlinked is passed to epoch_retire()
+ * instead of being freed, and is only freed once every thread that was
+ * inside a bracket at the time has left it, so it can no longer be
+ * reachable. */
+
+#define EPOCH_MAX_THREADS 64
+
+/* retire this many objects between attempts to advance the epoch */
+#define EPOCH_COLLECT_EVERY 64
+
+typedef void (*epoch_free_fn)(void* ptr, void* ctx);
+
+typedef struct {
+	void* ptr;
+	epoch_free_fn free_fn;
+	void* ctx;
+	unsigned long epoch;	/* global epoch when it was retired */
+} epoch_retired;
+
+typedef struct {
+	/* the global epoch seen on entry shifted left one, with the low bit
+	 * set while inside a bracket */
+	atomic_ulong local;
+	atomic_bool in_use;
+	int nesting;
+	epoch_retired* retired;
+	size_t nretired;
+	size_t capacity;
+	size_t since_collect;
+} epoch_thread;
+
+typedef struct {
+	atomic_ulong epoch;
+	epoch_thread threads[EPOCH_MAX_THREADS];
+	/* left behind by threads that have left, freed by whoever collects
+	 * next */
+	mtx_t orphans_lock;
+	epoch_retired* orphans;
+	size_t norphans;
+} epoch_domain;
+
+void init_epoch_domain(epoch_domain* d);
+
+/* frees everything still retired, no other thread may be using d */
+void destroy_epoch_domain(epoch_domain* d);
+
+/* each thread using d needs its own epoch_thread, NULL if there are already
+ * EPOCH_MAX_THREADS */
+epoch_thread* epoch_join(epoch_domain* d);
+void epoch_leave(epoch_domain* d, epoch_thread* t);
+
+/* brackets may nest, memory is only protected from the outermost enter to
+ * the matching exit */
+void epoch_enter(epoch_domain* d, epoch_thread* t);
+void epoch_exit(epoch_domain* d, epoch_thread* t);
+
+/* calls free_fn(ptr, ctx) once no thread can still be reading ptr */
+void epoch_retire(epoch_domain* d, epoch_thread* t, void* ptr,
+		  epoch_free_fn free_fn, void* ctx);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef INTRUSIVE_H
+#define INTRUSIVE_H
+
+#include <stddef.h>
+
+/* Intrusive, type specialised lists. Rather than a node pointing at the data,
+ * the links live inside the user's own struct:
+ *
+ *	struct item {
+ *		int value;
+ *		LIST_LINK(struct item) link;
+ *	};
+ *	LIST_DEFINE(items, struct item, link)
+ *
+ * which defines items_append_node(), items_delete_node() and so on, taking
+ * and returning struct item* directly. Nothing is allocated by the list, and
+ * the compiler can see the types, so each element is one object with no void*
+ * casts in between. As with node, NULL marks either end of the list.
+ *
+ * The operations and their argument order match linked_list.h, except that
+ * delete only unlinks, since the list does not own its elements. */
+
+#define LIST_LINK(type) struct { type* prev; type* next; }
+
+#define LIST_DEFINE(name, type, link) \
+	static inline void name##_init_node(type* n) { \
+		n->link.prev = NULL; \
+		n->link.next = NULL; \
+	} \
+	\
+	static inline type* name##_get_next(type* where) { \
+		return where->link.next; \
+	} \
+	\
+	static inline type* name##_get_prev(type* where) { \
+		return where->link.prev; \
+	} \
+	\
+	static inline void name##_insert_node(type* prev, type* new, type* next) { \
+		prev->link.next = new; \
+		new->link.prev = prev; \
+		next->link.prev = new; \
+		new->link.next = next; \
+	} \
+	\
+	/* puts new after where */ \
+	static inline void name##_append_node(type* where, type* new) { \
+		if (where->link.next == NULL) { \
+			where->link.next = new; \
+			new->link.prev = where; \
+		} else { \
+			name##_insert_node(where, new, where->link.next); \
+		} \
+	} \
+	\
+	/* puts new before where */ \
+	static inline void name##_prepend_node(type* new, type* where) { \
+		if (where->link.prev == NULL) { \
+			where->link.prev = new; \
+			new->link.next = where; \
+		} else { \
+			name##_insert_node(where->link.prev, new, where); \
+		} \
+	} \
+	\
+	/* unlinks where, which is left to the caller to free if need be */ \
+	static inline void name##_delete_node(type* where) { \
+		type* prev = where->link.prev; \
+		type* next = where->link.next; \
+		if (prev != NULL) { \
+			prev->link.next = next; \
+		} \
+		if (next != NULL) { \
+			next->link.prev = prev; \
+		} \
+		name##_init_node(where); \
+	} \
+	\
+	static inline type* name##_get_n_forward(type* where, int n) { \
+		for ( ; (n > 0) && (where != NULL) ; n--) { \
+			where = where->link.next; \
+		} \
+		return where; \
+	} \
+	\
+	static inline type* name##_get_n_back(type* where, int n) { \
+		for ( ; (n > 0) && (where != NULL) ; n--) { \
+			where = where->link.prev; \
+		} \
+		return where; \
+	}
+
+#endif
@@ -69,7 +69,7 @@ void prepend_node(node* new, node* where) {
 	}
 }
 
-void delete_node(node* where) {
+void unlink_node(node* where) {
 	node* prev = get_prev(where);
 	node* next = get_next(where);
 
@@ -81,7 +81,10 @@ void delete_node(node* where) {
 	} else if (next != NULL) {
 		next->prev = NULL;
 	}
+}
 
+void delete_node(node* where) {
+	unlink_node(where);
 	free(where);
 }
 
@@ -94,37 +97,59 @@ node* get_prev(node* where) {
 
 }
 
+/* These are loops rather than recursion, since at -O0 nothing turns the tail
+ * call into a jump and a long walk would overflow the stack. For frequent
+ * positional access, see skiplist.h. */
+
 node* get_n_forward(node* where, int n) {
-	if (n <= 0) {
-		return where;
-	} else {
-		return get_n_forward(get_next(where), n - 1);
+	for ( ; (n > 0) && (where != NULL) ; n--) {
+		where = get_next(where);
 	}
+	return where;
 }
 
 node* get_n_back(node* where, int n) {
-	if (n <= 0) {
-		return where;
-	} else {
-		return get_n_back(get_prev(where), n - 1);
+	for ( ; (n > 0) && (where != NULL) ; n--) {
+		where = get_prev(where);
 	}
+	return where;
 }
 
+/* The buffers from these must be freed by the caller. Prefer the snprint_
+ * and fprint_ versions below, which do not allocate. */
+
 char* sprint_node(node* what) {
 	char* buf = (char*) malloc(sizeof(char) * SPRINT_BUF_SIZE);
-	sprintf(buf, "%p -> %p -> %p", (void*) what->prev, (void*) what,
-					 (void*) what->next);
+	snprint_node(buf, SPRINT_BUF_SIZE, what);
 	return buf;
 }
 
 char* sprint_node_int(node* what) {
 	char* buf = (char*) malloc(sizeof(char) * SPRINT_BUF_SIZE);
-	int val = * ((int*) what->data);
-	sprintf(buf, "%p -> %p (%i) -> %p", (void*) what->prev,
-					      (void*) what, val,
-					      (void*) what->next);
+	snprint_node_int(buf, SPRINT_BUF_SIZE, what);
 	return buf;
+}
+
+int snprint_node(char* buf, size_t size, node* what) {
+	return snprintf(buf, size, "%p -> %p -> %p", (void*) what->prev,
+			(void*) what, (void*) what->next);
+}
 
+int snprint_node_int(char* buf, size_t size, node* what) {
+	int val = * ((int*) what->data);
+	return snprintf(buf, size, "%p -> %p (%i) -> %p", (void*) what->prev,
+			(void*) what, val, (void*) what->next);
+}
+
+int fprint_node(FILE* fp, node* what) {
+	return fprintf(fp, "%p -> %p -> %p", (void*) what->prev,
+		       (void*) what, (void*) what->next);
+}
+
+int fprint_node_int(FILE* fp, node* what) {
+	int val = * ((int*) what->data);
+	return fprintf(fp, "%p -> %p (%i) -> %p", (void*) what->prev,
+		       (void*) what, val, (void*) what->next);
 }
 
 node* create_node_int(int data) {
@@ -133,3 +158,63 @@ node* create_node_int(int data) {
 	return create_node((void*) n);
 }
 
+void splice_nodes(node* where, node* first, node* last) {
+	node* next = get_next(where);
+
+	where->next = first;
+	first->prev = where;
+	last->next = next;
+	if (next != NULL) {
+		next->prev = last;
+	}
+}
+
+/* links on each new node directly, rather than through append_node() */
+static void build_link(node** head, node** prev, node* new) {
+	new->prev = *prev;
+	if (*prev != NULL) {
+		(*prev)->next = new;
+	} else {
+		*head = new;
+	}
+	*prev = new;
+}
+
+node* build_list(void** data, size_t n) {
+	node* head = NULL;
+	node* prev = NULL;
+
+	for (size_t i = 0 ; i < n ; i++) {
+		build_link(&head, &prev, create_node(data[i]));
+	}
+
+	return head;
+}
+
+node* build_list_int(const int* values, size_t n) {
+	node* head = NULL;
+	node* prev = NULL;
+
+	for (size_t i = 0 ; i < n ; i++) {
+		build_link(&head, &prev, create_node_int(values[i]));
+	}
+
+	return head;
+}
+
+size_t flatten_list(node* head, void** out, size_t max) {
+	size_t n = 0;
+	for ( ; (head != NULL) && (n < max) ; head = get_next(head)) {
+		out[n++] = head->data;
+	}
+	return n;
+}
+
+size_t flatten_list_int(node* head, int* out, size_t max) {
+	size_t n = 0;
+	for ( ; (head != NULL) && (n < max) ; head = get_next(head)) {
+		out[n++] = *((int*) head->data);
+	}
+	return n;
+}
+
@@ -17,12 +17,44 @@ void insert_node(node* prev, node* new, node* next);
 void append_node(node* new, node* where);
 void prepend_node(node* new, node* where);
 void delete_node(node* where);
+
+/* takes where out of its list without freeing it, for nodes that did not
+ * come from create_node() (see pool_delete_node()) */
+void unlink_node(node* where);
 node* get_next(node* where);
 node* get_prev(node* where);
 node* get_n_forward(node* where, int n);
 node* get_n_back(node* where, int n);
 char* sprint_node(node* what);
 char* sprint_node_int(node* what);
+
+/* Like sprint_node() and sprint_node_int(), but writing into a buffer of
+ * size bytes that the caller owns, as snprintf() does. Return the length of
+ * the full text, which was truncated if it is size or more. */
+int snprint_node(char* buf, size_t size, node* what);
+int snprint_node_int(char* buf, size_t size, node* what);
+
+/* as above, but writing straight to fp, returning what fprintf() does */
+int fprint_node(FILE* fp, node* what);
+int fprint_node_int(FILE* fp, node* what);
 node* create_node_int(int data);
 
+/* Links the chain first ... last in after where, in O(1). first must have no
+ * prev and last no next. */
+void splice_nodes(node* where, node* first, node* last);
+
+/* makes a list of n nodes pointing at data[0] ... data[n-1], returning its
+ * head (NULL if n is 0) */
+node* build_list(void** data, size_t n);
+
+/* as build_list(), but making int nodes like create_node_int() */
+node* build_list_int(const int* values, size_t n);
+
+/* copies up to max data pointers from the list into out, returning how many
+ * were copied */
+size_t flatten_list(node* head, void** out, size_t max);
+
+/* as flatten_list(), but copying out the ints of int nodes */
+size_t flatten_list_int(node* head, int* out, size_t max);
+
 #endif
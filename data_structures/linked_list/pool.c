@@ -0,0 +1,133 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdalign.h>
+#include <string.h>
+#include "pool.h"
+
+/* Slab allocator for list nodes */
+
+typedef union slab {
+	union slab* next;
+	max_align_t align;
+} slab;
+
+#define ROUND_UP(n, to) ((((n) + (to) - 1) / (to)) * (to))
+
+static size_t payload_offset(void) {
+	return ROUND_UP(sizeof(node), alignof(max_align_t));
+}
+
+node_pool* create_pool(size_t payload_size, size_t slab_nodes) {
+	node_pool* pool = (node_pool*) malloc(sizeof(node_pool));
+	pool->slabs = NULL;
+	pool->free_list = NULL;
+	pool->payload_size = payload_size;
+	pool->cell_size = sizeof(node);
+	if (payload_size > 0) {
+		pool->cell_size = ROUND_UP(payload_offset() + payload_size,
+					   alignof(max_align_t));
+	}
+	pool->slab_nodes = (slab_nodes > 0) ? slab_nodes : POOL_DEFAULT_SLAB_NODES;
+	pool->slab_used = pool->slab_nodes; /* so the first node makes a slab */
+	pool->live = 0;
+	return pool;
+}
+
+void destroy_pool(node_pool* pool) {
+	slab* s = (slab*) pool->slabs;
+	while (s != NULL) {
+		slab* next = s->next;
+		free(s);
+		s = next;
+	}
+	free(pool);
+}
+
+static node* pool_take(node_pool* pool) {
+	node* n;
+
+	if (pool->free_list != NULL) {
+		n = pool->free_list;
+		pool->free_list = (node*) n->next;
+	} else {
+		if (pool->slab_used == pool->slab_nodes) {
+			slab* s = (slab*) malloc(sizeof(slab) +
+						 pool->cell_size * pool->slab_nodes);
+			s->next = (slab*) pool->slabs;
+			pool->slabs = s;
+			pool->slab_used = 0;
+		}
+		char* cells = (char*) pool->slabs + sizeof(slab);
+		n = (node*) (cells + pool->cell_size * pool->slab_used);
+		pool->slab_used++;
+	}
+
+	pool->live++;
+	return n;
+}
+
+node* create_node_pooled(node_pool* pool, void* data) {
+	node* n = pool_take(pool);
+	n->prev = NULL;
+	n->next = NULL;
+
+	if (pool->payload_size > 0) {
+		n->data = (char*) n + payload_offset();
+		if (data != NULL) {
+			memcpy(n->data, data, pool->payload_size);
+		}
+	} else {
+		n->data = data;
+	}
+
+	return n;
+}
+
+node* create_node_int_pooled(node_pool* pool, int data) {
+	if (pool->payload_size < sizeof(int)) {
+		return NULL;
+	}
+	node* n = create_node_pooled(pool, NULL);
+	*((int*) n->data) = data;
+	return n;
+}
+
+void pool_release_node(node_pool* pool, node* n) {
+	n->prev = NULL;
+	n->next = pool->free_list;
+	pool->free_list = n;
+	pool->live--;
+}
+
+void pool_delete_node(node_pool* pool, node* where) {
+	unlink_node(where);
+	pool_release_node(pool, where);
+}
@@ -0,0 +1,49 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include "linked_list.h"
+
+/* Hands out nodes from large slabs instead of one malloc() per node. Each node
+ * can carry payload_size bytes of inline payload right after it, which its
+ * data pointer points to, so that a list of ints needs no allocation per
+ * element at all. Nodes given back by pool_delete_node() go on a free list
+ * and are handed out again before the pool grows. */
+typedef struct {
+	void* slabs;		/* newest first */
+	node* free_list;	/* linked through next */
+	size_t payload_size;
+	size_t cell_size;	/* node plus payload, rounded up for alignment */
+	size_t slab_nodes;	/* nodes per slab */
+	size_t slab_used;	/* nodes handed out from the newest slab */
+	size_t live;		/* nodes handed out and not yet deleted */
+} node_pool;
+
+#define POOL_DEFAULT_SLAB_NODES 4096
+
+/* slab_nodes of 0 uses POOL_DEFAULT_SLAB_NODES */
+node_pool* create_pool(size_t payload_size, size_t slab_nodes);
+
+/* Frees every slab, and so every node ever created from pool, in O(slabs).
+ * This is the fast way to tear down a list whose nodes all came from one
+ * pool. */
+void destroy_pool(node_pool* pool);
+
+/* If the pool has an inline payload, payload_size bytes are copied from data
+ * into it (unless data is NULL), otherwise the node points to data as with
+ * create_node(). */
+node* create_node_pooled(node_pool* pool, void* data);
+
+/* pool must have been created with a payload_size of at least sizeof(int),
+ * returns NULL otherwise */
+node* create_node_int_pooled(node_pool* pool, int data);
+
+/* puts a node, which must already be unlinked, back on the free list */
+void pool_release_node(node_pool* pool, node* n);
+
+/* like delete_node(), for a node that came from pool. Nodes don't record
+ * which pool they came from, so that they stay three pointers big, so
+ * delete_node() must not be used on them. */
+void pool_delete_node(node_pool* pool, node* where);
+
+#endif
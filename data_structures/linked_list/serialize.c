@@ -0,0 +1,141 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* mmap() and friends are POSIX, not C11 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "serialize.h"
+
+/* Binary list snapshots */
+
+/* big enough that a save is a few large writes */
+#define SAVE_BUF_SIZE (1 << 20)
+
+int save_list(node* head, size_t elem_size, const char* path) {
+	list_file_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, LIST_FILE_MAGIC, sizeof(LIST_FILE_MAGIC));
+	header.elem_size = elem_size;
+	for (node* n = head ; n != NULL ; n = get_next(n)) {
+		header.count++;
+	}
+
+	FILE* fp = fopen(path, "wb");
+	if (fp == NULL) {
+		return -1;
+	}
+	setvbuf(fp, NULL, _IOFBF, SAVE_BUF_SIZE);
+
+	fwrite(&header, sizeof(header), 1, fp);
+	for (node* n = head ; n != NULL ; n = get_next(n)) {
+		fwrite(n->data, elem_size, 1, fp);
+	}
+
+	int err = ferror(fp);
+	if ((fclose(fp) != 0) || err) {
+		return -1;
+	}
+	return 0;
+}
+
+int save_list_int(node* head, const char* path) {
+	return save_list(head, sizeof(int), path);
+}
+
+node* load_list(const char* path, node_pool* pool) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return NULL;
+	}
+	size_t size = st.st_size;
+	if (size < sizeof(list_file_header)) {
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	unsigned char* map = (unsigned char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return NULL;
+	}
+	posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+
+	list_file_header header;
+	memcpy(&header, map, sizeof(header));
+	bool ok = (memcmp(header.magic, LIST_FILE_MAGIC, sizeof(LIST_FILE_MAGIC)) == 0) &&
+		(header.elem_size > 0) &&
+		(header.count <= (size - sizeof(header)) / header.elem_size) &&
+		((pool == NULL) || (pool->payload_size == header.elem_size));
+	if (!ok) {
+		munmap(map, size);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	node* head = NULL;
+	node* prev = NULL;
+	unsigned char* elem = map + sizeof(header);
+	for (uint64_t i = 0 ; i < header.count ; i++, elem += header.elem_size) {
+		node* new;
+		if (pool != NULL) {
+			new = create_node_pooled(pool, elem);
+		} else {
+			void* data = malloc(header.elem_size);
+			memcpy(data, elem, header.elem_size);
+			new = create_node(data);
+		}
+
+		new->prev = prev;
+		if (prev != NULL) {
+			prev->next = new;
+		} else {
+			head = new;
+		}
+		prev = new;
+	}
+
+	munmap(map, size);
+	errno = 0;
+	return head;
+}
@@ -0,0 +1,35 @@
+#ifndef SERIALIZE_H
+#define SERIALIZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "linked_list.h"
+#include "pool.h"
+
+/* A binary snapshot of a list, for saving and restoring lists of millions of
+ * elements quickly. The file is a short header followed by every element's
+ * data, elem_size bytes each, back to back in list order, so saving is one
+ * sequential write and loading maps the file and walks it once. Files are in
+ * the byte order of the machine that wrote them. */
+
+#define LIST_FILE_MAGIC "LLIST\0\1"
+
+typedef struct {
+	char magic[8];		/* LIST_FILE_MAGIC, including its NUL */
+	uint64_t count;
+	uint64_t elem_size;
+} list_file_header;
+
+/* writes the elem_size bytes each node's data points to, returning 0 on
+ * success or -1 with errno set */
+int save_list(node* head, size_t elem_size, const char* path);
+int save_list_int(node* head, const char* path);
+
+/* Rebuilds a saved list, returning its head, or NULL with errno set if the
+ * file cannot be read or is not a saved list (an empty list also gives
+ * NULL, with errno 0). If pool is not NULL, nodes come from it, and it must
+ * have an inline payload of elem_size bytes. Otherwise each node's data is
+ * malloc()ed, as create_node_int() does. */
+node* load_list(const char* path, node_pool* pool);
+
+#endif
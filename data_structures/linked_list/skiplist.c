@@ -0,0 +1,204 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "skiplist.h"
+
+/* Indexable skip list, following Pugh, "A Skip List Cookbook" (1990), section
+ * 3.4, with the span bookkeeping used by Redis sorted sets. */
+
+static skip_node* alloc_skip_node(int level, void* data) {
+	skip_node* n = (skip_node*) malloc(sizeof(skip_node) +
+					   level * sizeof(n->links[0]));
+	n->prev = NULL;
+	n->data = data;
+	n->level = level;
+	for (int i = 0 ; i < level ; i++) {
+		n->links[i].next = NULL;
+		n->links[i].span = 0;
+	}
+	return n;
+}
+
+/* each level holds a quarter of the nodes of the one below */
+static int random_level(skiplist* list) {
+	int level = 1;
+	for (;;) {
+		/* xorshift32 */
+		list->rng ^= list->rng << 13;
+		list->rng ^= list->rng >> 17;
+		list->rng ^= list->rng << 5;
+		if (((list->rng & 3) != 0) || (level == SKIPLIST_MAX_LEVEL)) {
+			return level;
+		}
+		level++;
+	}
+}
+
+skiplist* create_skiplist(void) {
+	skiplist* list = (skiplist*) malloc(sizeof(skiplist));
+	list->head = alloc_skip_node(SKIPLIST_MAX_LEVEL, NULL);
+	list->level = 1;
+	list->length = 0;
+	list->rng = 2463534242u;
+	return list;
+}
+
+void free_skiplist(skiplist* list) {
+	skip_node* n = list->head;
+	while (n != NULL) {
+		skip_node* next = n->links[0].next;
+		free(n);
+		n = next;
+	}
+	free(list);
+}
+
+size_t skiplist_length(skiplist* list) {
+	return list->length;
+}
+
+skip_node* skiplist_get_n(skiplist* list, size_t n) {
+	if (n >= list->length) {
+		return NULL;
+	}
+
+	/* the head is at rank 0, so element n is at rank n + 1 */
+	skip_node* x = list->head;
+	size_t rank = 0;
+	for (int i = list->level - 1 ; i >= 0 ; i--) {
+		while ((x->links[i].next != NULL) &&
+		       (rank + x->links[i].span <= n + 1)) {
+			rank += x->links[i].span;
+			x = x->links[i].next;
+		}
+		if (rank == n + 1) {
+			return x;
+		}
+	}
+	return NULL;
+}
+
+/* finds the last node before rank n + 1 on every level, and its rank */
+static void find_before(skiplist* list, size_t n, skip_node** update, size_t* ranks) {
+	skip_node* x = list->head;
+	size_t rank = 0;
+	for (int i = list->level - 1 ; i >= 0 ; i--) {
+		while ((x->links[i].next != NULL) &&
+		       (rank + x->links[i].span <= n)) {
+			rank += x->links[i].span;
+			x = x->links[i].next;
+		}
+		update[i] = x;
+		ranks[i] = rank;
+	}
+}
+
+skip_node* skiplist_insert_n(skiplist* list, size_t n, void* data) {
+	skip_node* update[SKIPLIST_MAX_LEVEL];
+	size_t ranks[SKIPLIST_MAX_LEVEL];
+
+	if (n > list->length) {
+		return NULL;
+	}
+
+	find_before(list, n, update, ranks);
+
+	int level = random_level(list);
+	if (level > list->level) {
+		for (int i = list->level ; i < level ; i++) {
+			update[i] = list->head;
+			ranks[i] = 0;
+			list->head->links[i].span = list->length;
+		}
+		list->level = level;
+	}
+
+	skip_node* new = alloc_skip_node(level, data);
+	for (int i = 0 ; i < level ; i++) {
+		new->links[i].next = update[i]->links[i].next;
+		new->links[i].span = update[i]->links[i].span - (n - ranks[i]);
+		update[i]->links[i].next = new;
+		update[i]->links[i].span = (n - ranks[i]) + 1;
+	}
+	/* links passing over the new node now skip one more */
+	for (int i = level ; i < list->level ; i++) {
+		update[i]->links[i].span++;
+	}
+
+	new->prev = (update[0] == list->head) ? NULL : update[0];
+	if (new->links[0].next != NULL) {
+		new->links[0].next->prev = new;
+	}
+
+	list->length++;
+	return new;
+}
+
+void* skiplist_delete_n(skiplist* list, size_t n) {
+	skip_node* update[SKIPLIST_MAX_LEVEL];
+	size_t ranks[SKIPLIST_MAX_LEVEL];
+
+	if (n >= list->length) {
+		return NULL;
+	}
+
+	find_before(list, n, update, ranks);
+	skip_node* target = update[0]->links[0].next;
+
+	for (int i = 0 ; i < list->level ; i++) {
+		if (update[i]->links[i].next == target) {
+			update[i]->links[i].span += target->links[i].span - 1;
+			update[i]->links[i].next = target->links[i].next;
+		} else {
+			update[i]->links[i].span--;
+		}
+	}
+
+	if (target->links[0].next != NULL) {
+		target->links[0].next->prev = target->prev;
+	}
+	while ((list->level > 1) &&
+	       (list->head->links[list->level - 1].next == NULL)) {
+		list->level--;
+	}
+
+	list->length--;
+	void* data = target->data;
+	free(target);
+	return data;
+}
+
+skip_node* skip_get_next(skip_node* where) {
+	return where->links[0].next;
+}
+
+skip_node* skip_get_prev(skip_node* where) {
+	return where->prev;
+}
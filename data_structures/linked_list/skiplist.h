@@ -0,0 +1,57 @@
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* An indexable skip list. Elements are kept in list order (there are no
+ * keys), and every link records how many elements it skips over, so the nth
+ * element can be found, and elements inserted or deleted by position, in
+ * expected O(log n) rather than the O(n) of get_n_forward(). */
+
+#define SKIPLIST_MAX_LEVEL 32
+
+typedef struct skip_node {
+	struct skip_node* prev;	/* level 0 only */
+	void* data;
+	int level;
+	struct {
+		struct skip_node* next;
+		/* elements skipped by following next, counting the one it
+		 * lands on. For a NULL next, the elements left after this
+		 * one. */
+		size_t span;
+	} links[];
+} skip_node;
+
+typedef struct {
+	skip_node* head;	/* sentinel before the first element */
+	int level;		/* highest level in use */
+	size_t length;
+	unsigned int rng;	/* for picking levels */
+} skiplist;
+
+skiplist* create_skiplist(void);
+
+/* frees the list and its nodes, but not the data they point to */
+void free_skiplist(skiplist* list);
+
+size_t skiplist_length(skiplist* list);
+
+/* the element at index n (from 0), or NULL if there are not that many */
+skip_node* skiplist_get_n(skiplist* list, size_t n);
+
+/* inserts data so that it ends up at index n, which may be the length of the
+ * list to append. Returns the new node, or NULL if n is out of range. */
+skip_node* skiplist_insert_n(skiplist* list, size_t n, void* data);
+
+/* deletes the element at index n, returning its data, or NULL if n is out of
+ * range */
+void* skiplist_delete_n(skiplist* list, size_t n);
+
+/* O(1) neighbours of a node, NULL at either end */
+skip_node* skip_get_next(skip_node* where);
+skip_node* skip_get_prev(skip_node* where);
+
+#endif
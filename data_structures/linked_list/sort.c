@@ -0,0 +1,215 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <threads.h>
+#include "sort.h"
+
+/* Bottom-up merge sort for node lists, in the style of the Linux kernel's
+ * list_sort(). Nodes are taken off the front of the list one at a time and
+ * carried up through a row of bins, where bin i holds a sorted run of 2^i
+ * nodes, merging as they go like a binary counter. The bins fit on the stack,
+ * so there is no allocation and no recursion, and only next pointers are
+ * touched until the end, when prev is fixed in one pass. */
+
+#define SORT_BINS 64
+
+int compare_int(const void* a, const void* b) {
+	int x = *((const int*) a);
+	int y = *((const int*) b);
+	return (x > y) - (x < y);
+}
+
+/* merges two NULL terminated runs, where all of a came before all of b, so
+ * ties go to a to keep the sort stable */
+static node* merge(node* a, node* b, node_cmp cmp) {
+	node head;
+	node* tail = &head;
+
+	while ((a != NULL) && (b != NULL)) {
+		if (cmp(a->data, b->data) <= 0) {
+			tail->next = a;
+			tail = a;
+			a = a->next;
+		} else {
+			tail->next = b;
+			tail = b;
+			b = b->next;
+		}
+	}
+	tail->next = (a != NULL) ? a : b;
+
+	return head.next;
+}
+
+/* sorts by next pointers only, leaving prev stale */
+static node* sort_run(node* head, node_cmp cmp) {
+	node* bins[SORT_BINS] = {NULL};
+
+	while (head != NULL) {
+		node* run = head;
+		head = head->next;
+		run->next = NULL;
+
+		int i = 0;
+		for ( ; (i < SORT_BINS - 1) && (bins[i] != NULL) ; i++) {
+			run = merge(bins[i], run, cmp);
+			bins[i] = NULL;
+		}
+		bins[i] = (bins[i] != NULL) ? merge(bins[i], run, cmp) : run;
+	}
+
+	/* higher bins hold earlier nodes */
+	node* sorted = NULL;
+	for (int i = 0 ; i < SORT_BINS ; i++) {
+		if (bins[i] != NULL) {
+			sorted = merge(bins[i], sorted, cmp);
+		}
+	}
+	return sorted;
+}
+
+static void fix_prev(node* head) {
+	node* prev = NULL;
+	for (node* n = head ; n != NULL ; n = n->next) {
+		n->prev = prev;
+		prev = n;
+	}
+}
+
+node* sort_list(node* head, node_cmp cmp) {
+	head = sort_run(head, cmp);
+	fix_prev(head);
+	return head;
+}
+
+typedef struct {
+	node* head;
+	node_cmp cmp;
+} sort_job;
+
+static int sort_worker(void* arg) {
+	sort_job* job = (sort_job*) arg;
+	job->head = sort_run(job->head, job->cmp);
+	return 0;
+}
+
+typedef struct {
+	node* a;
+	node* b;
+	node_cmp cmp;
+} merge_job;
+
+static int merge_worker(void* arg) {
+	merge_job* job = (merge_job*) arg;
+	job->a = merge(job->a, job->b, job->cmp);
+	return 0;
+}
+
+#define SORT_MAX_THREADS 64
+
+node* sort_list_parallel(node* head, node_cmp cmp, int threads) {
+	sort_job jobs[SORT_MAX_THREADS];
+	thrd_t tids[SORT_MAX_THREADS];
+	bool started[SORT_MAX_THREADS];
+	size_t length = 0;
+
+	if (threads < 2) {
+		return sort_list(head, cmp);
+	}
+	for (node* n = head ; n != NULL ; n = n->next) {
+		length++;
+	}
+	if ((size_t) threads > length / 2) {
+		threads = length / 2;
+	}
+	if (threads < 2) {
+		return sort_list(head, cmp);
+	}
+	if (threads > SORT_MAX_THREADS) {
+		threads = SORT_MAX_THREADS;
+	}
+
+	/* cut into threads pieces of nearly equal length, in order */
+	for (int t = 0 ; t < threads ; t++) {
+		size_t piece = length * (t + 1) / threads - length * t / threads;
+		jobs[t].head = head;
+		jobs[t].cmp = cmp;
+		node* last = head;
+		for (size_t i = 1 ; i < piece ; i++) {
+			last = last->next;
+		}
+		head = last->next;
+		last->next = NULL;
+	}
+
+	/* a piece whose thread could not be started is done on this one */
+	for (int t = 0 ; t < threads ; t++) {
+		started[t] = thrd_create(&(tids[t]), sort_worker, &(jobs[t])) ==
+			thrd_success;
+		if (!started[t]) {
+			sort_worker(&(jobs[t]));
+		}
+	}
+	for (int t = 0 ; t < threads ; t++) {
+		if (started[t]) {
+			thrd_join(tids[t], NULL);
+		}
+	}
+
+	/* merge neighbouring pieces pairwise, each round on its own threads,
+	 * always with the earlier piece first so that ties keep their order */
+	merge_job merges[SORT_MAX_THREADS / 2];
+	int pieces = threads;
+	while (pieces > 1) {
+		int pairs = pieces / 2;
+		for (int p = 0 ; p < pairs ; p++) {
+			merges[p] = (merge_job) {jobs[2*p].head, jobs[2*p+1].head, cmp};
+			started[p] = thrd_create(&(tids[p]), merge_worker, &(merges[p])) ==
+				thrd_success;
+			if (!started[p]) {
+				merge_worker(&(merges[p]));
+			}
+		}
+		for (int p = 0 ; p < pairs ; p++) {
+			if (started[p]) {
+				thrd_join(tids[p], NULL);
+			}
+			jobs[p].head = merges[p].a;
+		}
+		if (pieces % 2 == 1) {
+			jobs[pairs].head = jobs[pieces - 1].head;
+		}
+		pieces = (pieces + 1) / 2;
+	}
+
+	fix_prev(jobs[0].head);
+	return jobs[0].head;
+}
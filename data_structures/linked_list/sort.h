@@ -0,0 +1,22 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include "linked_list.h"
+
+/* compares the data of two nodes, as for qsort() */
+typedef int (*node_cmp)(const void* a, const void* b);
+
+/* compares nodes made by create_node_int() or create_node_int_pooled() */
+int compare_int(const void* a, const void* b);
+
+/* Sorts the list starting at head in place, returning the new head. The sort
+ * is stable, needs no recursion, and allocates nothing: nodes are relinked,
+ * never copied. O(n log n). */
+node* sort_list(node* head, node_cmp cmp);
+
+/* as sort_list(), but cuts the list into one piece per thread, sorts the
+ * pieces at the same time, and then merges them. Still stable. Fewer than 2
+ * threads sorts on the calling thread, and no more than 64 are used. */
+node* sort_list_parallel(node* head, node_cmp cmp, int threads);
+
+#endif
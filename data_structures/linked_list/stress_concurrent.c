@@ -0,0 +1,191 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <threads.h>
+#include "stress_concurrent.h"
+
+/* Hammers one clist from several threads at once with random inserts,
+ * deletes and lookups over a small range of keys, so that they constantly
+ * collide. Every element's data records its key, and is scribbled over when
+ * it is freed, so a lookup that returns the wrong data or data that has
+ * already been freed is caught. At the end, the list must be sorted, and
+ * must hold exactly as many elements as were inserted and not deleted.
+ *
+ * usage: stress_concurrent.bin [threads] [operations per thread]
+ *
+ * Build with -fsanitize=address or -fsanitize=thread for a more thorough
+ * check. */
+
+#define KEY_RANGE 256
+#define ALIVE 0x600DF00Dul
+#define DEAD 0xDEADBEEFul
+
+typedef struct {
+	long key;
+	unsigned long state;
+} payload;
+
+typedef struct {
+	clist* list;
+	int ops;
+	unsigned int seed;
+	long net_inserts;	/* inserts minus deletes that succeeded */
+	long deletes;		/* deletes that succeeded */
+	long bad_finds;
+} worker;
+
+static atomic_long freed;
+
+static void free_payload(void* data) {
+	payload* p = (payload*) data;
+	p->state = DEAD;
+	atomic_fetch_add(&freed, 1);
+	free(p);
+}
+
+static unsigned int next_random(unsigned int* seed) {
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+static int run_worker(void* arg) {
+	worker* w = (worker*) arg;
+	epoch_thread* t = clist_join(w->list);
+
+	for (int i = 0 ; i < w->ops ; i++) {
+		unsigned int r = next_random(&(w->seed));
+		long key = r % KEY_RANGE;
+
+		switch ((r >> 16) % 3) {
+		case 0: {
+			payload* p = (payload*) malloc(sizeof(payload));
+			p->key = key;
+			p->state = ALIVE;
+			if (clist_insert(w->list, t, key, p)) {
+				w->net_inserts++;
+			} else {
+				free(p);
+			}
+			break;
+		}
+		case 1:
+			if (clist_delete(w->list, t, key)) {
+				w->net_inserts--;
+				w->deletes++;
+			}
+			break;
+		default: {
+			clist_enter(w->list, t);
+			payload* p = (payload*) clist_find(w->list, t, key);
+			if ((p != NULL) && ((p->key != key) || (p->state != ALIVE))) {
+				w->bad_finds++;
+			}
+			clist_exit(w->list, t);
+			break;
+		}
+		}
+	}
+
+	clist_leave(w->list, t);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	int nthreads = (argc > 1) ? atoi(argv[1]) : 8;
+	int ops = (argc > 2) ? atoi(argv[2]) : 200000;
+
+	if ((nthreads < 1) || (nthreads > EPOCH_MAX_THREADS) || (ops < 1)) {
+		fprintf(stderr, "usage: %s [threads] [operations per thread]\n", argv[0]);
+		return 1;
+	}
+
+	clist* list = create_clist(free_payload);
+	worker* workers = (worker*) malloc(sizeof(worker) * nthreads);
+	thrd_t* threads = (thrd_t*) malloc(sizeof(thrd_t) * nthreads);
+
+	atomic_init(&freed, 0);
+	for (int i = 0 ; i < nthreads ; i++) {
+		workers[i] = (worker) {
+			.list = list,
+			.ops = ops,
+			.seed = 2463534242u + i * 7919,
+			.net_inserts = 0,
+			.deletes = 0,
+			.bad_finds = 0
+		};
+		thrd_create(&(threads[i]), run_worker, &(workers[i]));
+	}
+
+	long expected = 0;
+	long deleted = 0;
+	long bad_finds = 0;
+	for (int i = 0 ; i < nthreads ; i++) {
+		thrd_join(threads[i], NULL);
+		expected += workers[i].net_inserts;
+		deleted += workers[i].deletes;
+		bad_finds += workers[i].bad_finds;
+	}
+
+	/* the list is quiet now, so it can be walked directly */
+	epoch_thread* t = clist_join(list);
+	long length = (long) clist_length(list, t);
+	bool sorted = true;
+	long last = -1;
+	cnode* n = (cnode*) atomic_load(&(list->head.next));
+	while (n != NULL) {
+		sorted = sorted && (n->key > last);
+		last = n->key;
+		n = (cnode*) (atomic_load(&(n->next)) & ~((uintptr_t) 1));
+	}
+	clist_leave(list, t);
+	free_clist(list);
+
+	/* every payload inserted should have been freed exactly once */
+	long inserted = expected + deleted;
+
+	printf("%i threads, %i operations each\n", nthreads, ops);
+	printf("length %li, expected %li\n", length, expected);
+	printf("payloads freed %li, inserted %li\n", atomic_load(&freed), inserted);
+	printf("lookups that saw bad data: %li\n", bad_finds);
+
+	free(threads);
+	free(workers);
+
+	if ((length != expected) || (bad_finds != 0) || !sorted ||
+	    (atomic_load(&freed) != inserted)) {
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,9 @@
+#ifndef STRESS_CONCURRENT_H
+#define STRESS_CONCURRENT_H
+
+#include <stdio.h>
+#include "concurrent.h"
+
+int main(int argc, char** argv);
+
+#endif
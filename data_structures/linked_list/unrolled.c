@@ -0,0 +1,210 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "unrolled.h"
+
+/* Unrolled doubly linked list. Every node other than the last is kept at
+ * least half full, by borrowing from or merging with the next node on
+ * delete, so that a list of n elements never has more than about
+ * 2n / UNROLLED_CAPACITY nodes. */
+
+/* aligned_alloc() needs the size to be a multiple of the alignment */
+_Static_assert(sizeof(unrolled_node) == UNROLLED_NODE_BYTES,
+	       "unrolled_node does not fill UNROLLED_NODE_BYTES exactly");
+
+static unrolled_node* alloc_unrolled_node(void) {
+	unrolled_node* n = (unrolled_node*) aligned_alloc(UNROLLED_NODE_BYTES,
+							 sizeof(unrolled_node));
+	n->prev = NULL;
+	n->next = NULL;
+	n->count = 0;
+	return n;
+}
+
+unrolled_node* create_unrolled(unrolled_elem data) {
+	unrolled_node* n = alloc_unrolled_node();
+	n->data[0] = data;
+	n->count = 1;
+	return n;
+}
+
+void free_unrolled(unrolled_node* head) {
+	while (head != NULL) {
+		unrolled_node* next = (unrolled_node*) head->next;
+		free(head);
+		head = next;
+	}
+}
+
+unrolled_pos unrolled_first(unrolled_node* head) {
+	unrolled_pos pos = {head, 0};
+	if (head->count == 0) {
+		pos.node = NULL;
+	}
+	return pos;
+}
+
+unrolled_elem* unrolled_get(unrolled_pos where) {
+	return &(where.node->data[where.index]);
+}
+
+/* inserts data before index (which may be n->count) in n, splitting n in two
+ * if it is full */
+static unrolled_pos insert_at(unrolled_node* n, int index, unrolled_elem data) {
+	if (n->count == (int) UNROLLED_CAPACITY) {
+		unrolled_node* split = alloc_unrolled_node();
+		int keep = n->count / 2;
+
+		split->count = n->count - keep;
+		memcpy(split->data, &(n->data[keep]),
+		       sizeof(unrolled_elem) * split->count);
+		n->count = keep;
+
+		split->prev = n;
+		split->next = n->next;
+		if (n->next != NULL) {
+			((unrolled_node*) n->next)->prev = split;
+		}
+		n->next = split;
+
+		if (index > keep) {
+			n = split;
+			index -= keep;
+		}
+	}
+
+	memmove(&(n->data[index + 1]), &(n->data[index]),
+		sizeof(unrolled_elem) * (n->count - index));
+	n->data[index] = data;
+	n->count++;
+
+	unrolled_pos pos = {n, index};
+	return pos;
+}
+
+unrolled_pos unrolled_append(unrolled_pos where, unrolled_elem data) {
+	return insert_at(where.node, where.index + 1, data);
+}
+
+unrolled_pos unrolled_prepend(unrolled_pos where, unrolled_elem data) {
+	return insert_at(where.node, where.index, data);
+}
+
+unrolled_pos unrolled_delete(unrolled_pos where) {
+	unrolled_node* n = where.node;
+	unrolled_node* next = (unrolled_node*) n->next;
+	int half = UNROLLED_CAPACITY / 2;
+
+	memmove(&(n->data[where.index]), &(n->data[where.index + 1]),
+		sizeof(unrolled_elem) * (n->count - where.index - 1));
+	n->count--;
+
+	if ((next != NULL) && (n->count < half)) {
+		if (next->count > half) {
+			/* borrow the first element of next */
+			n->data[n->count] = next->data[0];
+			n->count++;
+			next->count--;
+			memmove(&(next->data[0]), &(next->data[1]),
+				sizeof(unrolled_elem) * next->count);
+		} else {
+			/* merge next into n */
+			memcpy(&(n->data[n->count]), next->data,
+			       sizeof(unrolled_elem) * next->count);
+			n->count += next->count;
+			n->next = next->next;
+			if (next->next != NULL) {
+				((unrolled_node*) next->next)->prev = n;
+			}
+			free(next);
+		}
+	} else if ((n->count == 0) && (n->prev != NULL)) {
+		/* the last node emptied, the first is never freed here */
+		((unrolled_node*) n->prev)->next = NULL;
+		free(n);
+		unrolled_pos end = {NULL, 0};
+		return end;
+	}
+
+	if (where.index < n->count) {
+		return where;
+	}
+	return unrolled_get_next((unrolled_pos) {n, n->count - 1});
+}
+
+unrolled_pos unrolled_get_next(unrolled_pos where) {
+	if (where.index + 1 < where.node->count) {
+		where.index++;
+		return where;
+	}
+
+	where.node = (unrolled_node*) where.node->next;
+	where.index = 0;
+	return where;
+}
+
+unrolled_pos unrolled_get_prev(unrolled_pos where) {
+	if (where.index > 0) {
+		where.index--;
+		return where;
+	}
+
+	where.node = (unrolled_node*) where.node->prev;
+	if (where.node != NULL) {
+		where.index = where.node->count - 1;
+	}
+	return where;
+}
+
+unrolled_pos unrolled_get_n_forward(unrolled_pos where, int n) {
+	/* skip whole nodes at a time */
+	while ((where.node != NULL) && (where.index + n >= where.node->count)) {
+		n -= where.node->count - where.index;
+		where.node = (unrolled_node*) where.node->next;
+		where.index = 0;
+	}
+	if (where.node != NULL) {
+		where.index += n;
+	}
+	return where;
+}
+
+unrolled_pos unrolled_get_n_back(unrolled_pos where, int n) {
+	while ((where.node != NULL) && (where.index - n < 0)) {
+		n -= where.index + 1;
+		where.node = (unrolled_node*) where.node->prev;
+		where.index = (where.node != NULL) ? where.node->count - 1 : 0;
+	}
+	if (where.node != NULL) {
+		where.index -= n;
+	}
+	return where;
+}
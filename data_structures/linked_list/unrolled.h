@@ -0,0 +1,56 @@
+#ifndef UNROLLED_H
+#define UNROLLED_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* An unrolled linked list keeps several elements in each node, stored inline
+ * rather than behind a data pointer. Walking it touches one node per
+ * UNROLLED_CAPACITY elements instead of two allocations per element, so
+ * scans run at close to the speed of an array. */
+
+typedef int unrolled_elem;
+
+/* each node is sized and aligned to this many bytes, two cache lines */
+#define UNROLLED_NODE_BYTES 128
+#define UNROLLED_CAPACITY ((UNROLLED_NODE_BYTES - 2 * sizeof(void*) - \
+			    sizeof(int)) / sizeof(unrolled_elem))
+
+typedef struct {
+	void* prev;
+	void* next;
+	int count;
+	unrolled_elem data[UNROLLED_CAPACITY];
+} unrolled_node;
+
+/* An element is found by its node and its index within that node. These play
+ * the part that node* plays for the plain list, a NULL node meaning the start
+ * or end of the list has been passed. Inserting or deleting can move the
+ * elements after the one inserted or deleted, so any other positions held in
+ * the same list should be considered stale afterwards. */
+typedef struct {
+	unrolled_node* node;
+	int index;
+} unrolled_pos;
+
+/* the first node of a list is never moved or freed until free_unrolled() */
+unrolled_node* create_unrolled(unrolled_elem data);
+void free_unrolled(unrolled_node* head);
+
+/* the first element of the list starting at head */
+unrolled_pos unrolled_first(unrolled_node* head);
+unrolled_elem* unrolled_get(unrolled_pos where);
+
+/* insert after/before where, returning the position of the new element */
+unrolled_pos unrolled_append(unrolled_pos where, unrolled_elem data);
+unrolled_pos unrolled_prepend(unrolled_pos where, unrolled_elem data);
+
+/* returns the position of the element that followed where */
+unrolled_pos unrolled_delete(unrolled_pos where);
+
+unrolled_pos unrolled_get_next(unrolled_pos where);
+unrolled_pos unrolled_get_prev(unrolled_pos where);
+unrolled_pos unrolled_get_n_forward(unrolled_pos where, int n);
+unrolled_pos unrolled_get_n_back(unrolled_pos where, int n);
+
+#endif
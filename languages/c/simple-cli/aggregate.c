@@ -0,0 +1,296 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The aggregates behind -a. Everything here can be merged, so with -j each
+ * worker thread keeps its own aggregate, and they are merged at the end.
+ */
+
+#include "aggregate.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+aggregate* alloc_aggregate(void) {
+	aggregate* a = calloc(1, sizeof(aggregate));
+	a->min = INT64_MAX;
+	a->max = INT64_MIN;
+	return a;
+}
+
+void free_aggregate(aggregate* a) {
+	free(a);
+}
+
+static int leading_bit(uint64_t u) {
+#ifdef __GNUC__
+	return 63 - __builtin_clzll(u);
+#else
+	int bit = 0;
+	while (u >>= 1) {
+		bit++;
+	}
+	return bit;
+#endif
+}
+
+static int bucket_of(uint64_t u) {
+	if (u < SKETCH_SUB_BUCKETS) {
+		return (int) u;
+	}
+	int shift = leading_bit(u) - SKETCH_SUB_BITS;
+	return (shift + 1) * SKETCH_SUB_BUCKETS + (int) (u >> shift) - SKETCH_SUB_BUCKETS;
+}
+
+/* the middle of a bucket's range of magnitudes */
+static uint64_t bucket_middle(int bucket) {
+	if (bucket < SKETCH_SUB_BUCKETS) {
+		return bucket;
+	}
+	int shift = bucket / SKETCH_SUB_BUCKETS - 1;
+	uint64_t top = bucket % SKETCH_SUB_BUCKETS + SKETCH_SUB_BUCKETS;
+	return (top << shift) + (((uint64_t) 1 << shift) >> 1);
+}
+
+void aggregate_values(aggregate* a, const int64_t* values, int n) {
+	if (n == 0) {
+		return;
+	}
+
+	/* the batch on its own, and then merged in the same way as whole
+	 * aggregates are */
+	double batch_sum = 0;
+	for (int i = 0 ; i < n ; i++) {
+		batch_sum += (double) values[i];
+	}
+	double batch_mean = batch_sum / n;
+	double batch_m2 = 0;
+	for (int i = 0 ; i < n ; i++) {
+		double d = (double) values[i] - batch_mean;
+		batch_m2 += d * d;
+	}
+
+	for (int i = 0 ; i < n ; i++) {
+		int64_t v = values[i];
+		uint64_t low = a->sum_low + (uint64_t) v;
+		a->sum_high += (low < a->sum_low) + ((v < 0) ? UINT64_MAX : 0);
+		a->sum_low = low;
+		a->min = (v < a->min) ? v : a->min;
+		a->max = (v > a->max) ? v : a->max;
+		if (v < 0) {
+			a->negative[bucket_of(0 - (uint64_t) v)]++;
+		} else {
+			a->positive[bucket_of((uint64_t) v)]++;
+		}
+	}
+
+	double total = (double) a->count + n;
+	double delta = batch_mean - a->mean;
+	a->mean += delta * n / total;
+	a->m2 += batch_m2 + delta * delta * (double) a->count * n / total;
+	a->count += n;
+}
+
+void merge_aggregate(aggregate* into, const aggregate* from) {
+	if (from->count == 0) {
+		return;
+	}
+
+	uint64_t low = into->sum_low + from->sum_low;
+	into->sum_high += from->sum_high + (low < into->sum_low);
+	into->sum_low = low;
+	into->min = (from->min < into->min) ? from->min : into->min;
+	into->max = (from->max > into->max) ? from->max : into->max;
+	for (int i = 0 ; i < SKETCH_BUCKETS ; i++) {
+		into->negative[i] += from->negative[i];
+		into->positive[i] += from->positive[i];
+	}
+
+	double total = (double) into->count + (double) from->count;
+	double delta = from->mean - into->mean;
+	into->mean += delta * (double) from->count / total;
+	into->m2 += from->m2 + delta * delta * (double) into->count *
+		(double) from->count / total;
+	into->count += from->count;
+}
+
+int64_t aggregate_quantile(const aggregate* a, double q) {
+	/* nearest rank, the smallest value with at least q of them at or
+	 * below it */
+	uint64_t rank = (uint64_t) ceil(q * (double) a->count);
+	rank = (rank < 1) ? 1 : ((rank > a->count) ? a->count : rank);
+
+	int64_t v = a->max;
+	uint64_t seen = 0;
+	for (int i = SKETCH_BUCKETS - 1 ; (i >= 0) && (seen < rank) ; i--) {
+		seen += a->negative[i];
+		if (seen >= rank) {
+			uint64_t m = bucket_middle(i);
+			v = (m >= (uint64_t) INT64_MAX + 1) ? INT64_MIN : -(int64_t) m;
+		}
+	}
+	for (int i = 0 ; (i < SKETCH_BUCKETS) && (seen < rank) ; i++) {
+		seen += a->positive[i];
+		if (seen >= rank) {
+			uint64_t m = bucket_middle(i);
+			v = (m > INT64_MAX) ? INT64_MAX : (int64_t) m;
+		}
+	}
+
+	/* the middle of the first or last bucket may be past the real ends */
+	return (v < a->min) ? a->min : ((v > a->max) ? a->max : v);
+}
+
+/* the percentile in a "pN" stat, or a negative number if it is not one */
+static double percentile(const char* name, size_t length) {
+	char buf[32];
+	char* end;
+
+	if ((length < 2) || (length >= sizeof(buf)) || (name[0] != 'p')) {
+		return -1;
+	}
+	memcpy(buf, name + 1, length - 1);
+	buf[length - 1] = '\0';
+	if ((buf[0] < '0') || (buf[0] > '9')) {
+		return -1;
+	}
+	double p = strtod(buf, &end);
+	return ((*end == '\0') && (p <= 100)) ? p : -1;
+}
+
+static bool is_stat(const char* name, size_t length, const char* stat) {
+	return (strlen(stat) == length) && (strncmp(name, stat, length) == 0);
+}
+
+static bool known_stat(const char* name, size_t length) {
+	static const char* stats[] = {"count", "sum", "min", "max", "mean",
+		"variance", "stddev"};
+	for (size_t i = 0 ; i < sizeof(stats) / sizeof(stats[0]) ; i++) {
+		if (is_stat(name, length, stats[i])) {
+			return true;
+		}
+	}
+	return percentile(name, length) >= 0;
+}
+
+bool check_stats(const char* stats) {
+	if (strcmp(stats, "all") == 0) {
+		return true;
+	}
+	for (const char* p = stats ; ; ) {
+		size_t length = strcspn(p, ",");
+		if (!known_stat(p, length)) {
+			fprintf(stderr, "unknown statistic '%.*s', expected count, "
+					"sum, min, max, mean, variance, stddev, pN or all\n",
+					(int) length, p);
+			return false;
+		}
+		if (p[length] == '\0') {
+			return true;
+		}
+		p += length + 1;
+	}
+}
+
+/* the exact sum, which is a 128 bit two's complement integer */
+static void print_sum(const aggregate* a, FILE* stream) {
+	uint64_t high = a->sum_high;
+	uint64_t low = a->sum_low;
+	bool negative = (high >> 63) != 0;
+	char digits[48];
+	int n = 0;
+
+	if (negative) {
+		high = ~high + (low == 0);
+		low = 0 - low;
+	}
+
+	/* divide by ten a 32 bit limb at a time, most significant first */
+	do {
+		uint32_t limbs[4] = {(uint32_t) (high >> 32), (uint32_t) high,
+			(uint32_t) (low >> 32), (uint32_t) low};
+		uint64_t rest = 0;
+		for (int i = 0 ; i < 4 ; i++) {
+			uint64_t part = (rest << 32) | limbs[i];
+			limbs[i] = (uint32_t) (part / 10);
+			rest = part % 10;
+		}
+		high = ((uint64_t) limbs[0] << 32) | limbs[1];
+		low = ((uint64_t) limbs[2] << 32) | limbs[3];
+		digits[n++] = '0' + (char) rest;
+	} while ((high != 0) || (low != 0));
+
+	if (negative) {
+		fputc('-', stream);
+	}
+	while (n > 0) {
+		fputc(digits[--n], stream);
+	}
+}
+
+void print_aggregate(const aggregate* a, const char* stats, FILE* stream) {
+	if (strcmp(stats, "all") == 0) {
+		stats = AGGREGATE_ALL;
+	}
+
+	for (const char* p = stats ; ; ) {
+		size_t length = strcspn(p, ",");
+		bool none = (a->count == 0);
+
+		fprintf(stream, "%.*s ", (int) length, p);
+		if (is_stat(p, length, "count")) {
+			fprintf(stream, "%llu", (unsigned long long) a->count);
+		} else if (is_stat(p, length, "sum")) {
+			print_sum(a, stream);
+		} else if (none) {
+			fprintf(stream, "nan");
+		} else if (is_stat(p, length, "min")) {
+			fprintf(stream, "%lld", (long long) a->min);
+		} else if (is_stat(p, length, "max")) {
+			fprintf(stream, "%lld", (long long) a->max);
+		} else if (is_stat(p, length, "mean")) {
+			fprintf(stream, "%.17g", a->mean);
+		} else if (is_stat(p, length, "variance")) {
+			fprintf(stream, "%.17g", (a->count > 1) ? a->m2 / (a->count - 1) : 0.0);
+		} else if (is_stat(p, length, "stddev")) {
+			fprintf(stream, "%.17g", (a->count > 1) ? sqrt(a->m2 / (a->count - 1)) : 0.0);
+		} else {
+			fprintf(stream, "%lld", (long long) aggregate_quantile(a,
+					percentile(p, length) / 100));
+		}
+		fputc('\n', stream);
+
+		if (p[length] == '\0') {
+			break;
+		}
+		p += length + 1;
+	}
+}
@@ -0,0 +1,86 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Quantiles come from a histogram whose buckets are exact below
+ * SKETCH_SUB_BUCKETS, and above that split each power of two into
+ * SKETCH_SUB_BUCKETS equal parts, so a quantile is never off by more than
+ * 1 / SKETCH_SUB_BUCKETS of its value. */
+#define SKETCH_SUB_BITS 7
+#define SKETCH_SUB_BUCKETS (1 << SKETCH_SUB_BITS)
+#define SKETCH_BUCKETS (SKETCH_SUB_BUCKETS * (64 - SKETCH_SUB_BITS + 1))
+
+/* what -a prints when given "all" */
+#define AGGREGATE_ALL "count,sum,min,max,mean,variance,stddev,p50,p90,p99,p99.9"
+
+/* Everything -a can report about a stream of values, in constant memory.
+ * Two aggregates of different parts of a stream can be merged into one of the
+ * whole stream, which gives the same result as having seen it all in one,
+ * apart from rounding in the mean and variance. */
+typedef struct {
+	uint64_t count;
+	uint64_t sum_low;	/* the sum is exact, as a 128 bit integer */
+	uint64_t sum_high;
+	int64_t min;
+	int64_t max;
+	double mean;		/* Welford's running mean, and sum of squared */
+	double m2;		/* differences from it */
+	uint64_t negative[SKETCH_BUCKETS];	/* by magnitude */
+	uint64_t positive[SKETCH_BUCKETS];	/* including zero */
+} aggregate;
+
+aggregate* alloc_aggregate(void);
+void free_aggregate(aggregate* a);
+
+void aggregate_values(aggregate* a, const int64_t* values, int n);
+
+/* adds the values from has seen to into */
+void merge_aggregate(aggregate* into, const aggregate* from);
+
+/* the value at quantile q, from 0 to 1, to within the sketch's accuracy.
+ * a must have seen at least one value. */
+int64_t aggregate_quantile(const aggregate* a, double q);
+
+/* Checks stats, a comma separated list of count, sum, min, max, mean,
+ * variance (of a sample), stddev and pN for the Nth percentile (such as p50 or
+ * p99.9), or "all". Prints what is wrong to stderr if it is not valid. */
+bool check_stats(const char* stats);
+
+/* prints each of stats as "name value" on its own line. Anything that is not
+ * defined for no values at all is printed as nan. */
+void print_aggregate(const aggregate* a, const char* stats, FILE* stream);
+
+#endif
@@ -0,0 +1,213 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * simple-cli --bench, which times each stage of the fast path on values made
+ * up in memory, so that how fast one stage is can be seen apart from the
+ * others and from how fast input arrives. The stages run one after another,
+ * each over all of the values, in the order they happen in the fast path.
+ */
+
+#include "bench.h"
+#include "binary.h"
+#include "aggregate.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* xorshift64, so that every run sees the same values */
+static uint64_t next_random(uint64_t* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+/* a random number of up to 31 (or 63) bits, shifted right a random amount so
+ * that short numbers are as common as long ones, with a random sign */
+static void make_values(int64_t* values, size_t count, bool wide) {
+	uint64_t state = 0x9E3779B97F4A7C15;
+	int bits = wide ? 64 : 32;
+
+	for (size_t i = 0 ; i < count ; i++) {
+		uint64_t r = next_random(&state);
+		int shift = (65 - bits) + (int) (r % (bits - 1));
+		int64_t magnitude = (int64_t) (next_random(&state) >> shift);
+		values[i] = (r & (1ULL << 63)) ? -magnitude : magnitude;
+	}
+}
+
+static void report(FILE* stream, const char* stage, double seconds, size_t count,
+		size_t bytes) {
+	if (seconds <= 0) {
+		seconds = 1e-9;
+	}
+	fprintf(stream, "%-14s %12.1f %10.1f %10.2f\n", stage, count / seconds / 1e6,
+			bytes / seconds / 1e6, seconds * 1e9 / count);
+}
+
+/* reads length bytes from fd into buf, FASTIO_CHUNK_SIZE at a time like
+ * the fast path does, and returns how long that took */
+static double time_read(int fd, char* buf, size_t length) {
+	double began = stats_clock();
+	for (size_t done = 0 ; done < length ; ) {
+		size_t want = length - done;
+		ssize_t n = read(fd, &(buf[done]), (want < FASTIO_CHUNK_SIZE) ? want : FASTIO_CHUNK_SIZE);
+		if (n <= 0) {
+			break;
+		}
+		done += n;
+	}
+	return stats_clock() - began;
+}
+
+static double time_write(int fd, const char* buf, size_t length) {
+	double began = stats_clock();
+	for (size_t done = 0 ; done < length ; ) {
+		size_t want = length - done;
+		ssize_t n = write(fd, &(buf[done]), (want < FASTIO_CHUNK_SIZE) ? want : FASTIO_CHUNK_SIZE);
+		if (n <= 0) {
+			break;
+		}
+		done += n;
+	}
+	return stats_clock() - began;
+}
+
+/* encodes values in format into buf a batch at a time, as transform_records()
+ * does, then decodes them back into decoded */
+static void bench_binary(FILE* stream, io_format format, const int64_t* values,
+		int64_t* decoded, size_t count, char* buf) {
+	static const char* encode_names[] = {"", "encode int32", "encode int64", "encode varint"};
+	static const char* decode_names[] = {"", "decode int32", "decode int64", "decode varint"};
+	double began = stats_clock();
+	char* dst = buf;
+
+	for (size_t i = 0 ; i < count ; i += FASTIO_BATCH) {
+		int n = (count - i < FASTIO_BATCH) ? (int) (count - i) : FASTIO_BATCH;
+		dst = encode_binary(format, &(values[i]), n, dst);
+	}
+	double encoding = stats_clock() - began;
+	size_t length = dst - buf;
+
+	began = stats_clock();
+	const char* p = buf;
+	for (size_t i = 0 ; i < count ; ) {
+		int n;
+		p = decode_binary(format, p, dst, &(decoded[i]), FASTIO_BATCH, &n);
+		i += n;
+	}
+	double decoding = stats_clock() - began;
+
+	report(stream, encode_names[format], encoding, count, length);
+	report(stream, decode_names[format], decoding, count, length);
+}
+
+bool run_bench(const transform* t, size_t count, FILE* stream) {
+	int zero = open("/dev/zero", O_RDONLY);
+	int null = open("/dev/null", O_WRONLY);
+	if ((zero < 0) || (null < 0)) {
+		if (zero >= 0) {
+			close(zero);
+		}
+		return false;
+	}
+
+	int64_t* values = malloc(sizeof(int64_t) * count);
+	int64_t* work = malloc(sizeof(int64_t) * count);
+	char* text = malloc(count * FASTIO_VALUE_MAX);
+	char* binary = malloc(count * FASTIO_VALUE_MAX);
+	make_values(values, count, t->e->wide);
+
+	/* touch every page now, so that faulting them in is not timed as part
+	 * of whichever stage happens to touch them first */
+	memset(work, 0, sizeof(int64_t) * count);
+	memset(text, 0, count * FASTIO_VALUE_MAX);
+	memset(binary, 0, count * FASTIO_VALUE_MAX);
+
+	fprintf(stream, "%zu values, %s\n", count,
+			t->e->wide ? "64 bit" : "32 bit");
+	fprintf(stream, "%-14s %12s %10s %10s\n", "stage", "Mvalues/s", "MB/s", "ns/value");
+
+	/* the text the values make, so that reading and writing move as much
+	 * as a real run would */
+	double began = stats_clock();
+	char* dst = text;
+	for (size_t i = 0 ; i < count ; i++) {
+		dst = format_line(dst, values[i]);
+	}
+	double formatting = stats_clock() - began;
+	size_t text_length = dst - text;
+
+	/* into binary, so as not to overwrite the text */
+	report(stream, "read", time_read(zero, binary, text_length), count, text_length);
+
+	began = stats_clock();
+	const char* p = text;
+	for (size_t i = 0 ; i < count ; i++) {
+		p = parse_line(p, dst, t->e->wide, &(work[i]));
+	}
+	report(stream, "parse text", stats_clock() - began, count, text_length);
+
+	for (int format = FORMAT_INT32 ; format <= FORMAT_VARINT ; format++) {
+		bench_binary(stream, (io_format) format, values, work, count, binary);
+	}
+
+	memcpy(work, values, sizeof(int64_t) * count);
+	began = stats_clock();
+	for (size_t i = 0 ; i < count ; i += FASTIO_BATCH) {
+		int n = (count - i < FASTIO_BATCH) ? (int) (count - i) : FASTIO_BATCH;
+		run_expr(t->e, &(work[i]), n);
+	}
+	report(stream, "compute", stats_clock() - began, count, sizeof(int64_t) * count);
+
+	aggregate* a = alloc_aggregate();
+	began = stats_clock();
+	for (size_t i = 0 ; i < count ; i += FASTIO_BATCH) {
+		int n = (count - i < FASTIO_BATCH) ? (int) (count - i) : FASTIO_BATCH;
+		aggregate_values(a, &(values[i]), n);
+	}
+	report(stream, "aggregate", stats_clock() - began, count, sizeof(int64_t) * count);
+	free_aggregate(a);
+
+	report(stream, "format text", formatting, count, text_length);
+	report(stream, "write", time_write(null, text, text_length), count, text_length);
+
+	free(values);
+	free(work);
+	free(text);
+	free(binary);
+	close(zero);
+	close(null);
+	return true;
+}
@@ -0,0 +1,141 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The binary formats of simple-cli, used by -i and -o. Fixed size values are
+ * assembled a byte at a time, which works on any host and which compilers
+ * turn into plain loads and stores on little endian ones. Each loop here
+ * handles a whole batch of values, so it can be vectorised.
+ */
+
+#include "binary.h"
+
+size_t binary_size(io_format format) {
+	switch (format) {
+		case FORMAT_INT32: return 4;
+		case FORMAT_INT64: return 8;
+		default: return 0;
+	}
+}
+
+static uint64_t load_le(const unsigned char* p, int size) {
+	uint64_t v = 0;
+	for (int i = 0 ; i < size ; i++) {
+		v |= (uint64_t) p[i] << (8 * i);
+	}
+	return v;
+}
+
+static void store_le(unsigned char* p, uint64_t v, int size) {
+	for (int i = 0 ; i < size ; i++) {
+		p[i] = (unsigned char) (v >> (8 * i));
+	}
+}
+
+static uint64_t zigzag(int64_t v) {
+	return ((uint64_t) v << 1) ^ (uint64_t) (0 - (int64_t) ((uint64_t) v >> 63));
+}
+
+static int64_t unzigzag(uint64_t u) {
+	return (int64_t) ((u >> 1) ^ (0 - (u & 1)));
+}
+
+const char* decode_binary(io_format format, const char* p, const char* end,
+		int64_t* values, int max, int* n) {
+	const unsigned char* u = (const unsigned char*) p;
+	const unsigned char* stop = (const unsigned char*) end;
+	int count = 0;
+
+	if (format == FORMAT_INT32) {
+		count = (stop - u) / 4;
+		count = (count < max) ? count : max;
+		for (int i = 0 ; i < count ; i++) {
+			values[i] = (int32_t) (uint32_t) load_le(&(u[4 * i]), 4);
+		}
+		u += 4 * count;
+	} else if (format == FORMAT_INT64) {
+		count = (stop - u) / 8;
+		count = (count < max) ? count : max;
+		for (int i = 0 ; i < count ; i++) {
+			values[i] = (int64_t) load_le(&(u[8 * i]), 8);
+		}
+		u += 8 * count;
+	} else {
+		/* most values in most streams are small, so a single byte is
+		 * tried first. Bits past the 64th of an overlong varint are
+		 * dropped. */
+		for ( ; (count < max) && (u < stop) ; count++) {
+			uint64_t v = *u++;
+			if (v & 0x80) {
+				v &= 0x7F;
+				int shift = 7;
+				unsigned char b;
+				do {
+					b = *u++;
+					if (shift < 64) {
+						v |= (uint64_t) (b & 0x7F) << shift;
+					}
+					shift += 7;
+				} while (b & 0x80);
+			}
+			values[count] = unzigzag(v);
+		}
+	}
+
+	*n = count;
+	return (const char*) u;
+}
+
+char* encode_binary(io_format format, const int64_t* values, int n, char* dst) {
+	unsigned char* u = (unsigned char*) dst;
+
+	if (format == FORMAT_INT32) {
+		for (int i = 0 ; i < n ; i++) {
+			store_le(&(u[4 * i]), (uint64_t) values[i], 4);
+		}
+		u += 4 * n;
+	} else if (format == FORMAT_INT64) {
+		for (int i = 0 ; i < n ; i++) {
+			store_le(&(u[8 * i]), (uint64_t) values[i], 8);
+		}
+		u += 8 * n;
+	} else {
+		for (int i = 0 ; i < n ; i++) {
+			uint64_t v = zigzag(values[i]);
+			while (v >= 0x80) {
+				*u++ = (unsigned char) (v | 0x80);
+				v >>= 7;
+			}
+			*u++ = (unsigned char) v;
+		}
+	}
+
+	return (char*) u;
+}
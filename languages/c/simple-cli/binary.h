@@ -0,0 +1,61 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <stdint.h>
+#include "fastio.h"
+
+/* a varint holds up to 64 bits, 7 to a byte */
+#define VARINT_MAX 10
+
+/* The binary formats. INT32 and INT64 are two's complement integers, least
+ * significant byte first, one after another with nothing in between. INT32
+ * output keeps the low 32 bits of each value.
+ *
+ * VARINT is 64 bit values zigzag encoded (0, -1, 1, -2, ... become 0, 1, 2,
+ * 3, ...) so that small negative numbers stay short, then written 7 bits at a
+ * time, least significant first, with the top bit of each byte set if another
+ * byte follows. This is the same as protobuf's sint64. */
+
+/* bytes in each value, or 0 for VARINT, whose values vary in size */
+size_t binary_size(io_format format);
+
+/* Decodes up to max whole values from [p, end) into values and stores how
+ * many in n. Returns the end of the last value decoded. */
+const char* decode_binary(io_format format, const char* p, const char* end,
+		int64_t* values, int max, int* n);
+
+/* encodes n values to dst, which must have n * FASTIO_VALUE_MAX bytes of
+ * room, and returns the end of what was written */
+char* encode_binary(io_format format, const int64_t* values, int n, char* dst);
+
+#endif
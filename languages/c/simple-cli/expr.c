@@ -0,0 +1,593 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The expression engine behind -e. An expression is compiled once into a short
+ * list of stack machine ops, which run_expr() applies to a batch of values an
+ * op at a time: each op is one simple loop over EXPR_BATCH values held in the
+ * L1 cache, which the compiler can vectorise, rather than a trip through an
+ * interpreter for every value.
+ *
+ * The compiler folds constants into the ops that use them, so "x*3+7" is just
+ * MULC 3, ADDC 7, applied to the values in place.
+ */
+
+#include "expr.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	const char* text;
+	const char* p;
+	expr* e;
+	int depth;		/* stack slots in use at this point in the code */
+	int x_uses;		/* in the current stage */
+	char* err;
+	size_t err_len;
+	bool failed;
+} compiler;
+
+static bool parse_sum(compiler* c);
+
+/* wrapping arithmetic, done on unsigned integers so that it is always
+ * defined. This is 64 bit arithmetic, and 32 bit results are got by keeping
+ * the low 32 bits of it afterwards with narrow(), which gives the same result
+ * for every op here as doing it in 32 bits would. */
+
+static int64_t wrap_add(int64_t a, int64_t b) {
+	return (int64_t) ((uint64_t) a + (uint64_t) b);
+}
+
+static int64_t wrap_sub(int64_t a, int64_t b) {
+	return (int64_t) ((uint64_t) a - (uint64_t) b);
+}
+
+static int64_t wrap_mul(int64_t a, int64_t b) {
+	return (int64_t) ((uint64_t) a * (uint64_t) b);
+}
+
+static int64_t wrap_div(int64_t a, int64_t b) {
+	if (b == 0) {
+		return 0;
+	}
+	if (b == -1) {
+		return wrap_sub(0, a);
+	}
+	return a / b;
+}
+
+static int64_t wrap_mod(int64_t a, int64_t b) {
+	if ((b == 0) || (b == -1)) {
+		return 0;
+	}
+	return a % b;
+}
+
+static int64_t wrap_abs(int64_t a) {
+	return (a < 0) ? wrap_sub(0, a) : a;
+}
+
+static int64_t narrow(int64_t a) {
+	return (int32_t) (uint32_t) (uint64_t) a;
+}
+
+/* true for the ops whose result may not fit in 32 bits when their operands
+ * do */
+static bool may_widen(opcode op) {
+	switch (op) {
+		case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+		case OP_NEG: case OP_ABS:
+		case OP_ADDC: case OP_MULC: case OP_DIVC:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static int64_t apply(opcode op, int64_t a, int64_t b) {
+	switch (op) {
+		case OP_ADD: case OP_ADDC: return wrap_add(a, b);
+		case OP_SUB: return wrap_sub(a, b);
+		case OP_MUL: case OP_MULC: return wrap_mul(a, b);
+		case OP_DIV: case OP_DIVC: return wrap_div(a, b);
+		case OP_MOD: case OP_MODC: return wrap_mod(a, b);
+		case OP_MIN: case OP_MINC: return (a < b) ? a : b;
+		case OP_MAX: case OP_MAXC: return (a > b) ? a : b;
+		case OP_NEG: return wrap_sub(0, a);
+		case OP_ABS: return wrap_abs(a);
+		default: return 0;
+	}
+}
+
+/* apply() at the width of e, for folding constants */
+static int64_t fold(const expr* e, opcode op, int64_t a, int64_t b) {
+	int64_t v = apply(op, a, b);
+	return e->wide ? v : narrow(v);
+}
+
+static bool error(compiler* c, const char* fmt, ...) {
+	if (!c->failed) {
+		va_list ap;
+		int n = snprintf(c->err, c->err_len, "column %i: ",
+				(int) (c->p - c->text) + 1);
+		va_start(ap, fmt);
+		if ((n >= 0) && ((size_t) n < c->err_len)) {
+			vsnprintf(c->err + n, c->err_len - n, fmt, ap);
+		}
+		va_end(ap);
+		c->failed = true;
+	}
+	return false;
+}
+
+static void push_op(expr* e, opcode op, int64_t a) {
+	if (e->n_ops == e->capacity) {
+		e->capacity = (e->capacity > 0) ? e->capacity * 2 : 8;
+		e->ops = realloc(e->ops, sizeof(expr_op) * e->capacity);
+	}
+	e->ops[e->n_ops].op = op;
+	e->ops[e->n_ops].a = a;
+	e->n_ops++;
+}
+
+static expr_op* last_op(expr* e, int back) {
+	return (e->n_ops > back) ? &(e->ops[e->n_ops - 1 - back]) : NULL;
+}
+
+/* the immediate form of a binary op, for when its right side is a constant */
+static opcode immediate(opcode op) {
+	switch (op) {
+		case OP_ADD: case OP_SUB: return OP_ADDC;
+		case OP_MUL: return OP_MULC;
+		case OP_DIV: return OP_DIVC;
+		case OP_MOD: return OP_MODC;
+		case OP_MIN: return OP_MINC;
+		case OP_MAX: return OP_MAXC;
+		default: return op;
+	}
+}
+
+static bool emit(compiler* c, opcode op, int64_t a) {
+	expr* e = c->e;
+	expr_op* top = last_op(e, 0);
+	expr_op* below = last_op(e, 1);
+
+	switch (op) {
+		case OP_X:
+		case OP_CONST:
+			if (++c->depth > EXPR_STACK_MAX) {
+				return error(c, "expression nests too deeply");
+			}
+			break;
+
+		case OP_NEG:
+		case OP_ABS:
+			if ((top != NULL) && (top->op == OP_CONST)) {
+				top->a = fold(e, op, top->a, 0);
+				return true;
+			}
+			break;
+
+		case OP_STAGE:
+			c->depth--;
+			break;
+
+		default:
+			c->depth--;
+			if ((top == NULL) || (top->op != OP_CONST)) {
+				break;
+			}
+			if (((op == OP_DIV) || (op == OP_MOD)) && (top->a == 0)) {
+				return error(c, "division by zero");
+			}
+
+			/* both sides constant */
+			if ((below != NULL) && (below->op == OP_CONST)) {
+				below->a = fold(e, op, below->a, top->a);
+				e->n_ops--;
+				return true;
+			}
+
+			/* x - c is x + -c */
+			a = (op == OP_SUB) ? fold(e, OP_NEG, top->a, 0) : top->a;
+			op = immediate(op);
+			e->n_ops--;
+
+			/* (x + a) + b is x + (a + b), and the same for *, even
+			 * when they wrap */
+			if ((below != NULL) && (below->op == op) &&
+					((op == OP_ADDC) || (op == OP_MULC))) {
+				below->a = fold(e, op, below->a, a);
+				return true;
+			}
+			break;
+	}
+
+	push_op(e, op, a);
+	return true;
+}
+
+static void skip_space(compiler* c) {
+	while ((*c->p == ' ') || (*c->p == '\t')) {
+		c->p++;
+	}
+}
+
+static bool accept(compiler* c, char ch) {
+	skip_space(c);
+	if (*c->p == ch) {
+		c->p++;
+		return true;
+	}
+	return false;
+}
+
+static bool expect(compiler* c, char ch) {
+	return accept(c, ch) || error(c, "expected '%c'", ch);
+}
+
+static bool is_name_char(char ch) {
+	return ((ch >= 'a') && (ch <= 'z')) || ((ch >= 'A') && (ch <= 'Z')) ||
+		((ch >= '0') && (ch <= '9')) || (ch == '_');
+}
+
+/* how many arguments the call whose '(' is at p has */
+static int count_args(const char* p) {
+	int depth = 0;
+	int args = 0;
+	bool empty = true;
+
+	for (p++ ; *p != '\0' ; p++) {
+		if (*p == '(') {
+			depth++;
+		} else if ((*p == ')') && (depth-- == 0)) {
+			break;
+		} else if ((*p == ',') && (depth == 0)) {
+			args++;
+		}
+		if ((*p != ' ') && (*p != '\t')) {
+			empty = false;
+		}
+	}
+	return empty ? 0 : args + 1;
+}
+
+static bool emit_x(compiler* c) {
+	c->x_uses++;
+	return emit(c, OP_X, 0);
+}
+
+/* Each function is its first argument with an op applied after each of the
+ * others, or after the first for abs. OP_X marks no op. */
+static const struct {
+	const char* name;
+	int arity;
+	opcode after[3];
+} functions[] = {
+	{"abs", 1, {OP_ABS, OP_X, OP_X}},
+	{"min", 2, {OP_X, OP_MIN, OP_X}},
+	{"max", 2, {OP_X, OP_MAX, OP_X}},
+	{"clamp", 3, {OP_X, OP_MAX, OP_MIN}}
+};
+
+static bool parse_call(compiler* c, const char* name, size_t length) {
+	int f = -1;
+	for (size_t i = 0 ; i < sizeof(functions) / sizeof(functions[0]) ; i++) {
+		if ((strlen(functions[i].name) == length) &&
+				(strncmp(functions[i].name, name, length) == 0)) {
+			f = i;
+		}
+	}
+	if (f < 0) {
+		c->p = name;
+		return error(c, "unknown name '%.*s'", (int) length, name);
+	}
+
+	int arity = functions[f].arity;
+	skip_space(c);
+	bool parens = (*c->p == '(');
+	int args = parens ? count_args(c->p) : 0;
+	if (!parens && (arity != 1)) {
+		return error(c, "expected '('");
+	}
+	if ((args != arity) && (args != arity - 1)) {
+		return error(c, "%s takes %i arguments", functions[f].name, arity);
+	}
+	if (parens) {
+		c->p++;
+	}
+
+	/* with one argument short, the first is x */
+	bool implicit = (args < arity);
+	for (int i = 0 ; i < arity ; i++) {
+		if ((i == 0) && implicit) {
+			if (!emit_x(c)) {
+				return false;
+			}
+		} else {
+			if ((i > (implicit ? 1 : 0)) && !expect(c, ',')) {
+				return false;
+			}
+			if (!parse_sum(c)) {
+				return false;
+			}
+		}
+		opcode op = functions[f].after[i];
+		if ((op != OP_X) && !emit(c, op, 0)) {
+			return false;
+		}
+	}
+	return !parens || expect(c, ')');
+}
+
+static bool parse_primary(compiler* c) {
+	skip_space(c);
+
+	if ((*c->p >= '0') && (*c->p <= '9')) {
+		/* one more than the largest value is allowed so that the
+		 * smallest can be written, and like every other result it
+		 * wraps */
+		char* end;
+		const char* start = c->p;
+		unsigned long long max = c->e->wide ?
+			(unsigned long long) INT64_MAX + 1 : (unsigned long long) INT32_MAX + 1;
+		errno = 0;
+		unsigned long long v = strtoull(c->p, &end, 10);
+		c->p = end;
+		if ((errno == ERANGE) || (v > max)) {
+			c->p = start;
+			return error(c, "constant out of range");
+		}
+		return emit(c, OP_CONST, fold(c->e, OP_ADD, (int64_t) v, 0));
+	}
+
+	if (accept(c, '(')) {
+		return parse_sum(c) && expect(c, ')');
+	}
+
+	if (is_name_char(*c->p)) {
+		const char* name = c->p;
+		while (is_name_char(*c->p)) {
+			c->p++;
+		}
+		if ((c->p - name == 1) && (*name == 'x')) {
+			return emit_x(c);
+		}
+		return parse_call(c, name, c->p - name);
+	}
+
+	if (*c->p == '\0') {
+		return error(c, "unexpected end of expression");
+	}
+	return error(c, "unexpected '%c'", *c->p);
+}
+
+static bool parse_unary(compiler* c) {
+	if (accept(c, '-')) {
+		return parse_unary(c) && emit(c, OP_NEG, 0);
+	}
+	return parse_primary(c);
+}
+
+static bool parse_product(compiler* c) {
+	if (!parse_unary(c)) {
+		return false;
+	}
+	for (;;) {
+		opcode op;
+		if (accept(c, '*')) {
+			op = OP_MUL;
+		} else if (accept(c, '/')) {
+			op = OP_DIV;
+		} else if (accept(c, '%')) {
+			op = OP_MOD;
+		} else {
+			return true;
+		}
+		if (!parse_unary(c) || !emit(c, op, 0)) {
+			return false;
+		}
+	}
+}
+
+static bool parse_sum(compiler* c) {
+	if (!parse_product(c)) {
+		return false;
+	}
+	for (;;) {
+		opcode op;
+		if (accept(c, '+')) {
+			op = OP_ADD;
+		} else if (accept(c, '-')) {
+			op = OP_SUB;
+		} else {
+			return true;
+		}
+		if (!parse_product(c) || !emit(c, op, 0)) {
+			return false;
+		}
+	}
+}
+
+/* The stack starts out holding x. A stage pushes its result on top, and
+ * OP_STAGE moves it down to replace x. If the only use of x in a stage is
+ * its very first op, the stage can work on x in place instead. */
+static bool parse_stage(compiler* c) {
+	int start = c->e->n_ops;
+	c->x_uses = 0;
+
+	if (!parse_sum(c)) {
+		return false;
+	}
+
+	expr* e = c->e;
+	if ((c->x_uses == 1) && (e->n_ops > start) && (e->ops[start].op == OP_X)) {
+		memmove(&(e->ops[start]), &(e->ops[start + 1]),
+				sizeof(expr_op) * (e->n_ops - start - 1));
+		e->n_ops--;
+		c->depth--;
+		return true;
+	}
+	return emit(c, OP_STAGE, 0);
+}
+
+expr* compile_expr(const char* text, bool wide, char* err, size_t err_len) {
+	compiler c;
+	memset(&c, 0, sizeof(c));
+	c.text = text;
+	c.p = text;
+	c.e = calloc(1, sizeof(expr));
+	c.e->wide = wide;
+	c.depth = 1;
+	c.err = err;
+	c.err_len = err_len;
+
+	do {
+		if (!parse_stage(&c)) {
+			free_expr(c.e);
+			return NULL;
+		}
+	} while (accept(&c, '|'));
+
+	skip_space(&c);
+	if (*c.p != '\0') {
+		error(&c, "unexpected '%c'", *c.p);
+		free_expr(c.e);
+		return NULL;
+	}
+	return c.e;
+}
+
+expr* expr_add(int64_t delta, bool wide) {
+	expr* e = calloc(1, sizeof(expr));
+	e->wide = wide;
+	push_op(e, OP_ADDC, wide ? delta : narrow(delta));
+	return e;
+}
+
+void free_expr(expr* e) {
+	free(e->ops);
+	free(e);
+}
+
+/* Runs e on up to EXPR_BATCH values, an op at a time. stack[0] is x. */
+static void run_batch(const expr* e, int64_t* values, int n) {
+	int64_t stack[EXPR_STACK_MAX][EXPR_BATCH];
+	int sp = 0;
+
+	memcpy(stack[0], values, sizeof(int64_t) * n);
+
+	for (int k = 0 ; k < e->n_ops ; k++) {
+		int64_t a = e->ops[k].a;
+		int64_t* top = stack[sp];
+		int64_t* below = (sp > 0) ? stack[sp - 1] : NULL;
+
+		switch (e->ops[k].op) {
+			case OP_X:
+				memcpy(stack[++sp], stack[0], sizeof(int64_t) * n);
+				break;
+			case OP_CONST:
+				sp++;
+				for (int i = 0 ; i < n ; i++) {
+					stack[sp][i] = a;
+				}
+				break;
+			case OP_STAGE:
+				memcpy(stack[0], top, sizeof(int64_t) * n);
+				sp = 0;
+				break;
+
+			case OP_ADDC:
+				for (int i = 0 ; i < n ; i++) {
+					top[i] = wrap_add(top[i], a);
+				}
+				break;
+			case OP_MULC:
+				for (int i = 0 ; i < n ; i++) {
+					top[i] = wrap_mul(top[i], a);
+				}
+				break;
+			case OP_DIVC:
+				for (int i = 0 ; i < n ; i++) {
+					top[i] = wrap_div(top[i], a);
+				}
+				break;
+			case OP_MODC:
+				for (int i = 0 ; i < n ; i++) {
+					top[i] = wrap_mod(top[i], a);
+				}
+				break;
+			case OP_MINC:
+				for (int i = 0 ; i < n ; i++) {
+					top[i] = (top[i] < a) ? top[i] : a;
+				}
+				break;
+			case OP_MAXC:
+				for (int i = 0 ; i < n ; i++) {
+					top[i] = (top[i] > a) ? top[i] : a;
+				}
+				break;
+			case OP_NEG:
+			case OP_ABS:
+				for (int i = 0 ; i < n ; i++) {
+					top[i] = apply(e->ops[k].op, top[i], 0);
+				}
+				break;
+
+			default:
+				for (int i = 0 ; i < n ; i++) {
+					below[i] = apply(e->ops[k].op, below[i], top[i]);
+				}
+				sp--;
+				break;
+		}
+
+		if (!e->wide && may_widen(e->ops[k].op)) {
+			int64_t* result = stack[sp];
+			for (int i = 0 ; i < n ; i++) {
+				result[i] = narrow(result[i]);
+			}
+		}
+	}
+
+	memcpy(values, stack[sp], sizeof(int64_t) * n);
+}
+
+void run_expr(const expr* e, int64_t* values, int n) {
+	for (int done = 0 ; done < n ; done += EXPR_BATCH) {
+		int count = (n - done < EXPR_BATCH) ? n - done : EXPR_BATCH;
+		run_batch(e, &(values[done]), count);
+	}
+}
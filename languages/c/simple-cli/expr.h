@@ -0,0 +1,94 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* the deepest an expression may nest */
+#define EXPR_STACK_MAX 16
+
+/* how many values each op is applied to before moving on to the next op */
+#define EXPR_BATCH 256
+
+typedef enum {
+	OP_X,		/* push x */
+	OP_CONST,	/* push a */
+	OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD, OP_MIN, OP_MAX,
+	OP_NEG, OP_ABS,
+	/* the top of the stack op a, so constants need no stack slot */
+	OP_ADDC, OP_MULC, OP_DIVC, OP_MODC, OP_MINC, OP_MAXC,
+	OP_STAGE	/* the top of the stack becomes x for the next stage */
+} opcode;
+
+typedef struct {
+	opcode op;
+	int64_t a;
+} expr_op;
+
+/* A compiled expression. It is only read while running, so one expr can be
+ * shared between threads. */
+typedef struct {
+	expr_op* ops;
+	int n_ops;
+	int capacity;
+	bool wide;		/* 64 bit arithmetic rather than 32 bit */
+} expr;
+
+/* Compiles text, for example "x*3+7 | clamp(0,1000)", which is one or more
+ * stages separated by '|'. Each stage is an integer expression in x, which is
+ * the input for the first stage and the result of the one before for the
+ * rest. It may use + - * / % (with the usual precedence), unary minus,
+ * parentheses, integer constants and the functions abs(v), min(a, b),
+ * max(a, b) and clamp(v, lo, hi). A function called with its first argument
+ * left out, or without parentheses at all for abs, is applied to x.
+ *
+ * Arithmetic is on 32 bit ints, or 64 bit ones if wide is set, and wraps
+ * around on overflow, as two's complement arithmetic does. Division or
+ * remainder by zero gives 0 (dividing by a constant zero is an error), and
+ * INT_MIN / -1 gives INT_MIN. There is no undefined behavior for any input.
+ *
+ * Returns NULL and writes a message to err if text is not valid. */
+expr* compile_expr(const char* text, bool wide, char* err, size_t err_len);
+
+/* the expression x + delta, on 64 bit ints if wide is set */
+expr* expr_add(int64_t delta, bool wide);
+
+void free_expr(expr* e);
+
+/* replaces each of the n values with the result of e on it. Unless e is
+ * wide, the values must be in the range of a 32 bit int, and so are the
+ * results. */
+void run_expr(const expr* e, int64_t* values, int n);
+
+#endif
@@ -0,0 +1,446 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This is the fast path of simple-cli, used by -f. It gives the same output as
+ * reading a line at a time with getline() and atoi() and writing each result
+ * with printf(), but reads input a megabyte at a time (or maps it, if it is a
+ * regular file), parses integers without going through the C library, and
+ * formats output into one big buffer which is written out with write().
+ *
+ * Input and output may also be binary, see binary.h.
+ */
+
+#include "fastio.h"
+#include "binary.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define FASTIO_SWAR 1
+#endif
+
+/* "00" through "99" */
+static const char digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+out_buf* alloc_out_buf(int fd) {
+	out_buf* out = malloc(sizeof(out_buf));
+	out->fd = fd;
+	out->capacity = FASTIO_CHUNK_SIZE;
+	out->data = malloc(out->capacity);
+	out->length = 0;
+	out->stats = NULL;
+	return out;
+}
+
+void free_out_buf(out_buf* out) {
+	free(out->data);
+	free(out);
+}
+
+bool flush_out_buf(out_buf* out) {
+	size_t done = 0;
+	double began = (out->stats != NULL) ? stats_clock() : 0;
+	while (done < out->length) {
+		ssize_t n = write(out->fd, &(out->data[done]), out->length - done);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		done += n;
+	}
+	if (out->stats != NULL) {
+		out->stats->write += stats_clock() - began;
+		out->stats->bytes_out += done;
+	}
+	out->length = 0;
+	return true;
+}
+
+bool reserve_out_buf(out_buf* out, size_t size) {
+	if (out->length + size <= out->capacity) {
+		return true;
+	}
+	if (out->fd >= 0) {
+		return flush_out_buf(out) && reserve_out_buf(out, size);
+	}
+	while (out->length + size > out->capacity) {
+		out->capacity *= 2;
+	}
+	out->data = realloc(out->data, out->capacity);
+	return true;
+}
+
+/* the end of the last whole value in [start, end), or NULL if there is none.
+ * For fixed size values, start must be the start of a value. */
+static const char* last_record_end(io_format format, const char* start, const char* end) {
+	size_t size = binary_size(format);
+	if (size > 0) {
+		size_t whole = (end - start) / size * size;
+		return (whole > 0) ? start + whole : NULL;
+	}
+
+	/* a line ends with a newline and a varint with a byte whose top bit
+	 * is clear */
+	while (end > start) {
+		char last = end[-1];
+		if ((format == FORMAT_TEXT) ? (last == '\n') : ((last & 0x80) == 0)) {
+			return end;
+		}
+		end--;
+	}
+	return NULL;
+}
+
+/* the end of the first whole value from start, or NULL if there is none */
+static const char* first_record_end(io_format format, const char* start, const char* end) {
+	size_t size = binary_size(format);
+	if (size > 0) {
+		return ((size_t) (end - start) >= size) ? start + size : NULL;
+	}
+	for ( ; start < end ; start++) {
+		if ((format == FORMAT_TEXT) ? (*start == '\n') : ((*start & 0x80) == 0)) {
+			return start + 1;
+		}
+	}
+	return NULL;
+}
+
+/* hands [start, end), which holds only whole values, to fn a chunk at a
+ * time */
+static bool split_records(io_format format, const char* start, const char* end,
+		records_fn fn, void* ctx) {
+	while (start < end) {
+		const char* stop = end;
+		if ((size_t) (end - start) > FASTIO_CHUNK_SIZE) {
+			stop = last_record_end(format, start, start + FASTIO_CHUNK_SIZE);
+			if (stop == NULL) {
+				stop = first_record_end(format, start, end);
+			}
+		}
+		if (!fn(start, stop, ctx)) {
+			return false;
+		}
+		start = stop;
+	}
+	return true;
+}
+
+/* Hands over what is left at the end of the input after the last whole value.
+ * For text, that is a last line with no newline after it, which is passed
+ * with one added. For the binary formats it is a value cut short. */
+static bool last_record(io_format format, const char* start, size_t length,
+		records_fn fn, void* ctx) {
+	if (format != FORMAT_TEXT) {
+		fprintf(stderr, "simple-cli: input ends part way through a value\n");
+		errno = 0;
+		return false;
+	}
+
+	char* copy = malloc(length + 1);
+	memcpy(copy, start, length);
+	copy[length] = '\n';
+	bool ok = fn(copy, copy + length + 1, ctx);
+	free(copy);
+	return ok;
+}
+
+/* With stats, only mapping the file counts as reading it. The pages are
+ * actually read in as they are first touched, which counts as parsing. */
+static bool read_mapped(int fd, size_t size, io_format format, records_fn fn,
+		void* ctx, io_stats* stats) {
+	double began = (stats != NULL) ? stats_clock() : 0;
+	const char* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	posix_madvise((void*) map, size, POSIX_MADV_SEQUENTIAL);
+	if (stats != NULL) {
+		stats->read += stats_clock() - began;
+		stats->bytes_in += size;
+	}
+
+	const char* end = last_record_end(format, map, map + size);
+	if (end == NULL) {
+		end = map;
+	}
+
+	bool ok = split_records(format, map, end, fn, ctx);
+	if (ok && (end < map + size)) {
+		ok = last_record(format, end, map + size - end, fn, ctx);
+	}
+	munmap((void*) map, size);
+	return ok;
+}
+
+static bool read_blocks(int fd, io_format format, records_fn fn, void* ctx,
+		io_stats* stats) {
+	size_t capacity = FASTIO_CHUNK_SIZE;
+	size_t length = 0;
+	char* buf = malloc(capacity);
+	bool ok = true;
+
+	for (;;) {
+		/* a value longer than the buffer, make room for more of it */
+		if (length == capacity) {
+			capacity *= 2;
+			buf = realloc(buf, capacity);
+		}
+
+		double began = (stats != NULL) ? stats_clock() : 0;
+		ssize_t n = read(fd, &(buf[length]), capacity - length);
+		if (stats != NULL) {
+			stats->read += stats_clock() - began;
+			stats->bytes_in += (n > 0) ? n : 0;
+		}
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			ok = false;
+			break;
+		}
+		if (n == 0) {
+			if (length > 0) {
+				ok = last_record(format, buf, length, fn, ctx);
+			}
+			break;
+		}
+
+		/* everything up to the end of the last whole value goes now,
+		 * the rest waits for the read that completes it. What was left
+		 * over last time holds no line or varint end, so only the new
+		 * bytes need looking at. */
+		size_t scanned = length;
+		length += n;
+		const char* from = (binary_size(format) > 0) ? buf : &(buf[scanned]);
+		const char* stop = last_record_end(format, from, &(buf[length]));
+		if (stop == NULL) {
+			continue;
+		}
+
+		size_t records = stop - buf;
+		if (!fn(buf, stop, ctx)) {
+			ok = false;
+			break;
+		}
+		memmove(buf, &(buf[records]), length - records);
+		length -= records;
+	}
+
+	free(buf);
+	return ok;
+}
+
+bool read_records(int fd, io_format format, records_fn fn, void* ctx, io_stats* stats) {
+	struct stat st;
+	if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+		return read_mapped(fd, st.st_size, format, fn, ctx, stats);
+	}
+	return read_blocks(fd, format, fn, ctx, stats);
+}
+
+#ifdef FASTIO_SWAR
+/* true if all eight bytes of chunk are '0' through '9' */
+static bool eight_digits(uint64_t chunk) {
+	return (((chunk & 0xF0F0F0F0F0F0F0F0) |
+		(((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+		0x3333333333333333);
+}
+
+/* the value of eight digits, the first of them in the lowest byte */
+static uint32_t parse_eight_digits(uint64_t chunk) {
+	chunk -= 0x3030303030303030;
+	chunk = (chunk * 10) + (chunk >> 8);
+	chunk = (((chunk & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) +
+		(((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+	return (uint32_t) chunk;
+}
+#endif
+
+const char* parse_line(const char* p, const char* end, bool wide, int64_t* value) {
+	unsigned long long v = 0;
+	int digits = 0;
+	bool negative = false;
+
+	/* the white space isspace() knows, except for the newline ending
+	 * the line */
+	while ((*p == ' ') || ((*p >= '\t') && (*p <= '\r') && (*p != '\n'))) {
+		p++;
+	}
+	if ((*p == '-') || (*p == '+')) {
+		negative = (*p == '-');
+		p++;
+	}
+	while (*p == '0') {
+		p++;
+	}
+
+#ifdef FASTIO_SWAR
+	/* eight digits at a time, while that cannot overflow v */
+	while ((digits <= 8) && (end - p >= 8)) {
+		uint64_t chunk;
+		memcpy(&chunk, p, sizeof(chunk));
+		if (!eight_digits(chunk)) {
+			break;
+		}
+		v = v * 100000000 + parse_eight_digits(chunk);
+		digits += 8;
+		p += 8;
+	}
+#endif
+
+	/* 19 digits always fit in v, any more than that are out of the range
+	 * of a long anyway */
+	for (unsigned d ; (d = (unsigned char) *p - '0') < 10 ; p++) {
+		if (digits < 19) {
+			v = v * 10 + d;
+		}
+		digits++;
+	}
+
+	/* atoi() is strtol() cast to an int. strtol() saturates at the range
+	 * of a long, and the cast keeps the low bits. strtoll() just
+	 * saturates. */
+	long long max = wide ? LLONG_MAX : LONG_MAX;
+	long long l;
+	if (negative) {
+		l = ((digits > 19) || (v > (unsigned long long) max + 1)) ?
+			-max - 1 : (long long) (0 - v);
+	} else {
+		l = ((digits > 19) || (v > (unsigned long long) max)) ? max : (long long) v;
+	}
+	*value = wide ? l : (int) (unsigned) l;
+
+	if (*p != '\n') {
+		p = memchr(p, '\n', end - p);
+	}
+	return p + 1;
+}
+
+char* format_line(char* dst, int64_t value) {
+	char digits[FASTIO_VALUE_MAX];
+	char* q = &(digits[FASTIO_VALUE_MAX]);
+	uint64_t u = (value < 0) ? 0u - (uint64_t) value : (uint64_t) value;
+
+	while (u >= 100) {
+		q -= 2;
+		memcpy(q, &(digit_pairs[(u % 100) * 2]), 2);
+		u /= 100;
+	}
+	if (u >= 10) {
+		q -= 2;
+		memcpy(q, &(digit_pairs[u * 2]), 2);
+	} else {
+		*--q = '0' + u;
+	}
+	if (value < 0) {
+		*--q = '-';
+	}
+
+	size_t length = &(digits[FASTIO_VALUE_MAX]) - q;
+	memcpy(dst, q, length);
+	dst[length] = '\n';
+	return dst + length + 1;
+}
+
+const char* next_batch(const char* start, const char* end, const transform* t,
+		int64_t* values, int* n, io_stats* stats) {
+	int count = 0;
+	double began = (stats != NULL) ? stats_clock() : 0;
+	if (t->in == FORMAT_TEXT) {
+		for ( ; (count < FASTIO_BATCH) && (start < end) ; count++) {
+			start = parse_line(start, end, t->e->wide, &(values[count]));
+		}
+	} else {
+		start = decode_binary(t->in, start, end, values, FASTIO_BATCH, &count);
+	}
+
+	if (stats == NULL) {
+		run_expr(t->e, values, count);
+	} else {
+		double parsed = stats_clock();
+		run_expr(t->e, values, count);
+		stats->parse += parsed - began;
+		stats->compute += stats_clock() - parsed;
+		stats->values += count;
+	}
+	*n = count;
+	return start;
+}
+
+bool transform_records(const char* start, const char* end, const transform* t,
+		out_buf* out, io_stats* stats) {
+	int64_t values[FASTIO_BATCH];
+
+	while (start < end) {
+		int n;
+		start = next_batch(start, end, t, values, &n, stats);
+
+		if (!reserve_out_buf(out, n * FASTIO_VALUE_MAX)) {
+			return false;
+		}
+
+		double began = (stats != NULL) ? stats_clock() : 0;
+		char* dst = &(out->data[out->length]);
+		if (t->out == FORMAT_TEXT) {
+			for (int i = 0 ; i < n ; i++) {
+				dst = format_line(dst, values[i]);
+			}
+		} else {
+			dst = encode_binary(t->out, values, n, dst);
+		}
+		out->length = dst - out->data;
+		if (stats != NULL) {
+			stats->format += stats_clock() - began;
+		}
+	}
+	return true;
+}
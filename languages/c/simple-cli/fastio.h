@@ -0,0 +1,122 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FASTIO_H
+#define FASTIO_H
+
+/* allow us to use mmap() and friends */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "expr.h"
+#include "stats.h"
+
+/* how much input is read, or handed over from a mapped file, at a time */
+#define FASTIO_CHUNK_SIZE (1024 * 1024)
+
+/* how many values are parsed before their results are computed and
+ * formatted */
+#define FASTIO_BATCH 4096
+
+/* the most bytes one value takes in any format, "-9223372036854775808\n" */
+#define FASTIO_VALUE_MAX 21
+
+/* Text is a decimal number per line, parsed like atoi() does. The rest are
+ * binary (see binary.h): little endian two's complement 32 or 64 bit
+ * integers, or zigzag encoded LEB128 varints. */
+typedef enum {FORMAT_TEXT=0, FORMAT_INT32, FORMAT_INT64, FORMAT_VARINT} io_format;
+
+/* how values are read and written, and what is computed from them */
+typedef struct {
+	io_format in;
+	io_format out;
+	const expr* e;
+} transform;
+
+/* Output is collected here and written out with write() once there is
+ * FASTIO_CHUNK_SIZE of it. An out_buf with an fd of -1 is never written out,
+ * it grows instead, and the caller takes the data from it. If stats is set,
+ * the time spent writing and the bytes written are added to it. */
+typedef struct {
+	int fd;
+	char* data;
+	size_t length;
+	size_t capacity;
+	io_stats* stats;
+} out_buf;
+
+out_buf* alloc_out_buf(int fd);
+void free_out_buf(out_buf* out);
+
+/* writes out everything buffered so far, returns false on a write error */
+bool flush_out_buf(out_buf* out);
+
+/* makes room for at least size more bytes, flushing or growing out */
+bool reserve_out_buf(out_buf* out, size_t size);
+
+/* Called with whole values in [start, end), so for text it always ends with
+ * a '\n'. */
+typedef bool (*records_fn)(const char* start, const char* end, void* ctx);
+
+/* Calls fn on all of fd, a chunk of whole values in the given format at a
+ * time. Regular files are mapped with mmap() rather than copied. A last line
+ * that is not ended by a newline is passed with one added, but a binary value
+ * cut short is an error. Stops early if fn returns false. Returns false if fd
+ * could not be read or fn returned false, with errno set to 0 if the error
+ * has already been reported. If stats is not NULL, the time spent reading
+ * and the bytes read are added to it. */
+bool read_records(int fd, io_format format, records_fn fn, void* ctx, io_stats* stats);
+
+/* Parses the line starting at p exactly like atoi() would, including what
+ * glibc's atoi() does on overflow, and stores it in value. If wide is set it
+ * is parsed like strtoll() instead. The line must end with a '\n' somewhere
+ * before end. Returns the start of the next line. */
+const char* parse_line(const char* p, const char* end, bool wide, int64_t* value);
+
+/* writes value and a newline to dst, which must have FASTIO_VALUE_MAX bytes
+ * of room, and returns the end of what was written */
+char* format_line(char* dst, int64_t value);
+
+/* Reads up to FASTIO_BATCH values from start in t's input format, runs t's
+ * expression on them, and stores the results in values and how many in n.
+ * Returns the start of the values after them. If stats is not NULL, the time
+ * spent parsing and computing is added to it. */
+const char* next_batch(const char* start, const char* end, const transform* t,
+		int64_t* values, int* n, io_stats* stats);
+
+/* Reads the values in [start, end) in t's input format, runs t's expression
+ * on them and appends the results to out in its output format. For text in
+ * and out, this is what the getline() loop in simple-cli.c does. stats is as
+ * for next_batch(), and also gets the time spent formatting. */
+bool transform_records(const char* start, const char* end, const transform* t,
+		out_buf* out, io_stats* stats);
+
+#endif
@@ -0,0 +1,248 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This is the multi-threaded mode of simple-cli, used by -j. The main thread
+ * reads input and hands it out in chunks of whole lines, worker threads
+ * process the chunks in any order, and a writer thread puts their output back
+ * in order.
+ */
+
+#include "pipeline.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* the most finished chunks the writer gathers into one writev() */
+#define PIPELINE_WRITEV_MAX 16
+
+static slot* slot_for(pipeline* p, size_t chunk) {
+	return &(p->slots[chunk % p->n_slots]);
+}
+
+static void fail(pipeline* p) {
+	pthread_mutex_lock(&(p->lock));
+	p->failed = true;
+	pthread_cond_broadcast(&(p->changed));
+	pthread_mutex_unlock(&(p->lock));
+}
+
+/* called by read_records() on the main thread */
+static bool enqueue(const char* start, const char* end, void* ctx) {
+	pipeline* p = (pipeline*) ctx;
+	size_t length = end - start;
+
+	pthread_mutex_lock(&(p->lock));
+	slot* s = slot_for(p, p->next_read);
+	while ((s->state != SLOT_FREE) && !p->failed) {
+		pthread_cond_wait(&(p->changed), &(p->lock));
+	}
+	bool failed = p->failed;
+	pthread_mutex_unlock(&(p->lock));
+	if (failed) {
+		return false;
+	}
+
+	/* the slot is ours until next_read moves past it */
+	if (s->in_capacity < length) {
+		s->in_capacity = length;
+		s->in = realloc(s->in, s->in_capacity);
+	}
+	memcpy(s->in, start, length);
+	s->in_length = length;
+
+	pthread_mutex_lock(&(p->lock));
+	s->state = SLOT_READ;
+	p->next_read++;
+	pthread_cond_broadcast(&(p->changed));
+	pthread_mutex_unlock(&(p->lock));
+	return true;
+}
+
+static void* worker(void* arg) {
+	pipeline* p = ((pipeline_worker*) arg)->p;
+	int index = ((pipeline_worker*) arg)->index;
+
+	for (;;) {
+		pthread_mutex_lock(&(p->lock));
+		while ((p->next_work == p->next_read) && !p->eof && !p->failed) {
+			pthread_cond_wait(&(p->changed), &(p->lock));
+		}
+		if (p->failed || (p->next_work == p->next_read)) {
+			pthread_mutex_unlock(&(p->lock));
+			return NULL;
+		}
+		slot* s = slot_for(p, p->next_work++);
+		s->state = SLOT_WORKING;
+		pthread_mutex_unlock(&(p->lock));
+
+		s->out->length = 0;
+		if (!p->fn(s->in, s->in + s->in_length, s->out, index, p->ctx)) {
+			fail(p);
+			return NULL;
+		}
+
+		pthread_mutex_lock(&(p->lock));
+		s->state = SLOT_DONE;
+		pthread_cond_broadcast(&(p->changed));
+		pthread_mutex_unlock(&(p->lock));
+	}
+}
+
+static bool write_all(int fd, struct iovec* iov, int count) {
+	while (count > 0) {
+		ssize_t n = writev(fd, iov, count);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			return false;
+		}
+
+		/* skip past whatever was written, which may end part way
+		 * through a buffer */
+		while ((count > 0) && ((size_t) n >= iov->iov_len)) {
+			n -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0) {
+			iov->iov_base = (char*) iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return true;
+}
+
+static void* writer(void* arg) {
+	pipeline* p = (pipeline*) arg;
+	struct iovec iov[PIPELINE_WRITEV_MAX];
+
+	for (;;) {
+		pthread_mutex_lock(&(p->lock));
+		while ((slot_for(p, p->next_write)->state != SLOT_DONE) &&
+				!(p->eof && (p->next_write == p->next_read)) &&
+				!p->failed) {
+			pthread_cond_wait(&(p->changed), &(p->lock));
+		}
+		if (p->failed || (p->next_write == p->next_read)) {
+			pthread_mutex_unlock(&(p->lock));
+			return NULL;
+		}
+
+		/* everything finished in order from next_write on */
+		int count = 0;
+		while ((count < PIPELINE_WRITEV_MAX) && (count < p->n_slots) &&
+				(slot_for(p, p->next_write + count)->state == SLOT_DONE)) {
+			out_buf* out = slot_for(p, p->next_write + count)->out;
+			iov[count].iov_base = out->data;
+			iov[count].iov_len = out->length;
+			count++;
+		}
+		pthread_mutex_unlock(&(p->lock));
+
+		double began = (p->stats != NULL) ? stats_clock() : 0;
+		if (p->stats != NULL) {
+			for (int i = 0 ; i < count ; i++) {
+				p->stats->bytes_out += iov[i].iov_len;
+			}
+		}
+		if (!write_all(p->out_fd, iov, count)) {
+			fail(p);
+			return NULL;
+		}
+		if (p->stats != NULL) {
+			p->stats->write += stats_clock() - began;
+		}
+
+		pthread_mutex_lock(&(p->lock));
+		for (int i = 0 ; i < count ; i++) {
+			slot_for(p, p->next_write++)->state = SLOT_FREE;
+		}
+		pthread_cond_broadcast(&(p->changed));
+		pthread_mutex_unlock(&(p->lock));
+	}
+}
+
+bool run_pipeline(int in_fd, io_format format, int out_fd, int threads,
+		chunk_fn fn, void* ctx, io_stats* stats) {
+	pipeline p;
+	pthread_t* workers = malloc(sizeof(pthread_t) * threads);
+	pipeline_worker* args = malloc(sizeof(pipeline_worker) * threads);
+	pthread_t writer_thread;
+
+	memset(&p, 0, sizeof(p));
+	p.n_slots = threads * PIPELINE_SLOTS_PER_THREAD;
+	p.slots = calloc(p.n_slots, sizeof(slot));
+	p.out_fd = out_fd;
+	p.fn = fn;
+	p.ctx = ctx;
+	p.stats = stats;
+	pthread_mutex_init(&(p.lock), NULL);
+	pthread_cond_init(&(p.changed), NULL);
+	for (int i = 0 ; i < p.n_slots ; i++) {
+		p.slots[i].out = alloc_out_buf(-1);
+	}
+
+	for (int i = 0 ; i < threads ; i++) {
+		args[i].p = &p;
+		args[i].index = i;
+		pthread_create(&(workers[i]), NULL, worker, &(args[i]));
+	}
+	pthread_create(&writer_thread, NULL, writer, &p);
+
+	bool read_ok = read_records(in_fd, format, enqueue, &p, stats);
+
+	/* chunks read before a read error are still written out */
+	pthread_mutex_lock(&(p.lock));
+	p.eof = true;
+	pthread_cond_broadcast(&(p.changed));
+	pthread_mutex_unlock(&(p.lock));
+
+	for (int i = 0 ; i < threads ; i++) {
+		pthread_join(workers[i], NULL);
+	}
+	pthread_join(writer_thread, NULL);
+
+	bool ok = read_ok && !p.failed;
+	for (int i = 0 ; i < p.n_slots ; i++) {
+		free(p.slots[i].in);
+		free_out_buf(p.slots[i].out);
+	}
+	free(p.slots);
+	free(workers);
+	free(args);
+	pthread_mutex_destroy(&(p.lock));
+	pthread_cond_destroy(&(p.changed));
+	return ok;
+}
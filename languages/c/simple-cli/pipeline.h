@@ -0,0 +1,93 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include "fastio.h"
+
+/* chunks in flight per worker thread, so that workers are not left waiting
+ * while the writer catches up */
+#define PIPELINE_SLOTS_PER_THREAD 2
+
+/* The work done on one chunk of whole values, appending its output to out.
+ * Called from several threads at once, so ctx must only be read, except for
+ * any part of it that belongs to the worker, numbered from 0, which is
+ * calling. */
+typedef bool (*chunk_fn)(const char* start, const char* end, out_buf* out,
+		int worker, void* ctx);
+
+typedef enum {SLOT_FREE=0, SLOT_READ, SLOT_WORKING, SLOT_DONE} slot_state;
+
+/* one chunk of input and the output it produced */
+typedef struct {
+	char* in;
+	size_t in_length;
+	size_t in_capacity;
+	out_buf* out;
+	slot_state state;
+} slot;
+
+/* Chunks are numbered in the order they are read. Chunk i lives in slot
+ * i % n_slots, and the writer frees each slot only once it has written the
+ * chunk in it, so output comes out in input order and never more than n_slots
+ * chunks are held at once, however big the input is. */
+typedef struct {
+	slot* slots;
+	int n_slots;
+	size_t next_read;	/* chunk the reader fills next */
+	size_t next_work;	/* chunk the next free worker takes */
+	size_t next_write;	/* chunk the writer waits for */
+	bool eof;
+	bool failed;
+	int out_fd;
+	chunk_fn fn;
+	void* ctx;
+	io_stats* stats;	/* reading on the main thread, writing on the writer */
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+} pipeline;
+
+typedef struct {
+	pipeline* p;
+	int index;
+} pipeline_worker;
+
+/* Reads in_fd a chunk of whole values in the given format at a time, has
+ * threads worker threads run fn on the chunks, and writes the output of each
+ * to out_fd in input order. Returns false on a read or write error, or if fn
+ * failed, with errno set to 0 if the error has already been reported. If stats
+ * is not NULL, the time spent reading and writing, and the bytes read and
+ * written, are added to it. */
+bool run_pipeline(int in_fd, io_format format, int out_fd, int threads,
+		chunk_fn fn, void* ctx, io_stats* stats);
+
+#endif
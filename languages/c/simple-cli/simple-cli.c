@@ -31,27 +31,205 @@
 /*
  * This program reads in integers from standard input, performs a simple
  * arithmetic operation on them, then outputs the result to standard out.
+ * The operation is adding or subtracting a quantity, or with -e, any
+ * expression expr.c can compile.
  *
  * It is intended to demonstrate correct handling of standard input, standard
  * output, and argument handling.
+ *
+ * With -f, the same work is done by the fast path in fastio.c instead, which
+ * gives exactly the same output many times faster. -j spreads the fast path
+ * over several threads (see pipeline.c). -i and -o read and write binary
+ * integers rather than text (see binary.h), on the fast path. -a prints
+ * statistics of the results instead of the results themselves (see
+ * aggregate.h). --stats reports where the time went on standard error, and
+ * --bench times each stage on its own (see bench.h).
  */
 
 #include "simple-cli.h"
 
+typedef struct {
+	const transform* t;
+	out_buf* out;
+	aggregate** partials;	/* one per worker with -a, otherwise NULL */
+	int n_partials;
+	const char* stats;
+	io_stats* counters;	/* one per worker with --stats, otherwise NULL */
+} fast_job;
+
+static bool run_job(fast_job* job, const char* start, const char* end,
+		out_buf* out, int worker) {
+	int64_t values[FASTIO_BATCH];
+	int n;
+	io_stats* counters = (job->counters != NULL) ? &(job->counters[worker]) : NULL;
+
+	if (job->partials == NULL) {
+		return transform_records(start, end, job->t, out, counters);
+	}
+	while (start < end) {
+		start = next_batch(start, end, job->t, values, &n, counters);
+		double began = (counters != NULL) ? stats_clock() : 0;
+		aggregate_values(job->partials[worker], values, n);
+		if (counters != NULL) {
+			counters->compute += stats_clock() - began;
+		}
+	}
+	return true;
+}
+
+static bool fast_records(const char* start, const char* end, void* ctx) {
+	fast_job* job = (fast_job*) ctx;
+	return run_job(job, start, end, job->out, 0);
+}
+
+static bool eval_records(const char* start, const char* end, out_buf* out,
+		int worker, void* ctx) {
+	return run_job((fast_job*) ctx, start, end, out, worker);
+}
+
+static void start_job(fast_job* job, const transform* t, const char* stats,
+		int workers, io_stats* counters) {
+	job->t = t;
+	job->out = NULL;
+	job->partials = NULL;
+	job->n_partials = workers;
+	job->stats = stats;
+	job->counters = NULL;
+	if (counters != NULL) {
+		job->counters = calloc(workers, sizeof(io_stats));
+	}
+	if (stats != NULL) {
+		job->partials = malloc(sizeof(aggregate*) * workers);
+		for (int i = 0 ; i < workers ; i++) {
+			job->partials[i] = alloc_aggregate();
+		}
+	}
+}
+
+/* with -a, merges what each worker saw and prints it, and with --stats adds
+ * up where each worker's time went in counters */
+static void finish_job(fast_job* job, bool ok, io_stats* counters) {
+	if (job->counters != NULL) {
+		for (int i = 0 ; i < job->n_partials ; i++) {
+			merge_io_stats(counters, &(job->counters[i]));
+		}
+		free(job->counters);
+	}
+	if (job->partials == NULL) {
+		return;
+	}
+	for (int i = 1 ; i < job->n_partials ; i++) {
+		merge_aggregate(job->partials[0], job->partials[i]);
+	}
+	if (ok) {
+		print_aggregate(job->partials[0], job->stats, stdout);
+	}
+	for (int i = 0 ; i < job->n_partials ; i++) {
+		free_aggregate(job->partials[i]);
+	}
+	free(job->partials);
+}
+
+/* errno is 0 if the error was already reported */
+static int failed(void) {
+	if (errno != 0) {
+		perror("simple-cli");
+	}
+	return 1;
+}
+
+static int run_fast(const transform* t, const char* stats, io_stats* counters) {
+	fast_job job;
+	bool ok;
+
+	start_job(&job, t, stats, 1, counters);
+	job.out = alloc_out_buf(STDOUT_FILENO);
+	job.out->stats = counters;
+	/* what was done before any error still goes out */
+	ok = read_records(STDIN_FILENO, t->in, fast_records, &job, counters);
+	ok = flush_out_buf(job.out) && ok;
+	free_out_buf(job.out);
+	finish_job(&job, ok, counters);
+
+	return ok ? 0 : failed();
+}
+
+static int run_threads(const transform* t, int threads, const char* stats,
+		io_stats* counters) {
+	fast_job job;
+	bool ok;
+
+	start_job(&job, t, stats, threads, counters);
+	ok = run_pipeline(STDIN_FILENO, t->in, STDOUT_FILENO, threads,
+			eval_records, &job, counters);
+	finish_job(&job, ok, counters);
+
+	return ok ? 0 : failed();
+}
+
+static bool parse_format(const char* name, io_format* format) {
+	static const char* names[] = {"text", "int32", "int64", "varint"};
+
+	for (int i = 0 ; i < 4 ; i++) {
+		if (strcmp(name, names[i]) == 0) {
+			*format = (io_format) i;
+			return true;
+		}
+	}
+	fprintf(stderr, "unknown format '%s', expected text, int32, int64 or varint\n",
+			name);
+	return false;
+}
+
+/* options with only a long form, numbered past any short one */
+enum {OPT_STATS = 256, OPT_BENCH};
+
+static const struct option long_options[] = {
+	{"stats", no_argument, NULL, OPT_STATS},
+	{"bench", optional_argument, NULL, OPT_BENCH},
+	{NULL, 0, NULL, 0}
+};
+
 int main(int argc, char** argv) {
 
 	int flag_s;
 	int flag_q;
-	char opt;
+	int flag_f;
+	int flag_j;
+	char* flag_e;
+	char* flag_a;
+	int flag_stats;
+	size_t flag_bench;
+	int q_given;
+	expr* e;
+	char err[128];
+	int status;
+	transform t;
+	bool wide;
+	io_stats counters;
+	double began;
+	int opt;
 	char* line;
 	size_t line_len;
 	int line_val;
+	int64_t value;
 
+	line = NULL;
 	line_len = 0;
 	flag_s = 0;
 	flag_q = 1;
+	flag_f = 0;
+	flag_j = 0;
+	flag_e = NULL;
+	flag_a = NULL;
+	flag_stats = 0;
+	flag_bench = 0;
+	q_given = 0;
+	t.in = FORMAT_TEXT;
+	t.out = FORMAT_TEXT;
 
-	while ((opt = getopt (argc, argv, "sq:h")) != -1) {
+	while ((opt = getopt_long (argc, argv, "sq:e:fj:i:o:a:h",
+					long_options, NULL)) != -1) {
 		switch (opt) {
 			case 's':
 				flag_s = 1;
@@ -61,6 +239,49 @@ int main(int argc, char** argv) {
 				 * because it has undefined behavior if
 				 * the argument cannot be converted */
 				flag_q = atoi(optarg);
+				q_given = 1;
+				break;
+			case 'e':
+				flag_e = optarg;
+				break;
+			case 'f':
+				flag_f = 1;
+				break;
+			case 'j':
+				flag_j = atoi(optarg);
+				if (flag_j < 1) {
+					fprintf(stderr, "-j needs at least 1 thread\n");
+					return 1;
+				}
+				break;
+			case 'i':
+				if (!parse_format(optarg, &(t.in))) {
+					return 1;
+				}
+				break;
+			case 'o':
+				if (!parse_format(optarg, &(t.out))) {
+					return 1;
+				}
+				break;
+			case 'a':
+				if (!check_stats(optarg)) {
+					return 1;
+				}
+				flag_a = optarg;
+				break;
+			case OPT_STATS:
+				flag_stats = 1;
+				break;
+			case OPT_BENCH:
+				flag_bench = BENCH_VALUES;
+				if (optarg != NULL) {
+					flag_bench = strtoull(optarg, NULL, 10);
+				}
+				if (flag_bench < 1) {
+					fprintf(stderr, "--bench needs at least 1 value\n");
+					return 1;
+				}
 				break;
 			case 'h':
 				printf("Read integers from standard input, ");
@@ -74,16 +295,100 @@ int main(int argc, char** argv) {
 				printf("-q [int] . . Specify quantity (");
 				printf("default: 1).\n\n");
 
+				printf("-e [expr]. . Compute this expression of x ");
+				printf("instead, for example\n");
+				printf("             'x*3+7 | clamp(0,1000)'. ");
+				printf("See expr.h.\n\n");
+
+				printf("-f . . . . . Use the fast path, which ");
+				printf("reads and writes in big\n");
+				printf("             blocks. The output is ");
+				printf("the same.\n\n");
+
+				printf("-j [int] . . Use the fast path on this ");
+				printf("many threads.\n\n");
+
+				printf("-i [format]  Read input in this format, ");
+				printf("one of text (the\n");
+				printf("             default), int32, int64 or ");
+				printf("varint. See binary.h.\n\n");
+
+				printf("-o [format]  Write output in this format.\n\n");
+
+				printf("-a [stats] . Print these statistics of ");
+				printf("the results instead of\n");
+				printf("             them, for example ");
+				printf("count,mean,p99 or all. See\n");
+				printf("             aggregate.h.\n\n");
+
+				printf("--stats. . . Use the fast path, and report ");
+				printf("how fast it went and\n");
+				printf("             where the time went to ");
+				printf("standard error.\n\n");
+
+				printf("--bench[=n]  Time each stage of the fast ");
+				printf("path on n values\n");
+				printf("             made up in memory ");
+				printf("(default: %d). See bench.h.\n\n",
+						BENCH_VALUES);
+
 				printf("-h . . . . . display this message.\n");
 
 		}
 
 	}
 
+	/* values that may not fit in an int are worked on as 64 bit ones */
+	wide = (t.in == FORMAT_INT64) || (t.in == FORMAT_VARINT) ||
+		(t.out == FORMAT_INT64) || (t.out == FORMAT_VARINT);
+
+	if ((flag_a != NULL) && (t.out != FORMAT_TEXT)) {
+		fprintf(stderr, "-a always prints text, it cannot be used with -o\n");
+		return 1;
+	}
+
+	if (flag_e != NULL) {
+		if (flag_s || q_given) {
+			fprintf(stderr, "-e cannot be used with -s or -q\n");
+			return 1;
+		}
+		e = compile_expr(flag_e, wide, err, sizeof(err));
+		if (e == NULL) {
+			fprintf(stderr, "-e: %s\n", err);
+			return 1;
+		}
+	} else {
+		/* -s and -q are the expression x + delta, which wraps on
+		 * overflow just like adding ints does in practice */
+		e = expr_add((flag_s) ? -(int64_t) flag_q : flag_q, wide);
+	}
+	t.e = e;
+
+	if (flag_bench) {
+		status = run_bench(&t, flag_bench, stdout) ? 0 : failed();
+		free_expr(e);
+		return status;
+	}
+	if (flag_j || flag_f || (t.in != FORMAT_TEXT) || (t.out != FORMAT_TEXT) ||
+			flag_a || flag_stats) {
+		memset(&counters, 0, sizeof(counters));
+		began = stats_clock();
+		if (flag_j) {
+			status = run_threads(&t, flag_j, flag_a, (flag_stats) ? &counters : NULL);
+		} else {
+			status = run_fast(&t, flag_a, (flag_stats) ? &counters : NULL);
+		}
+		if (flag_stats) {
+			print_io_stats(&counters, stats_clock() - began, stderr);
+		}
+		free_expr(e);
+		return status;
+	}
+
 	while(getline(&line, &line_len, stdin) >= 0) {
 
 		/* remove trailing newline */
-		for (int i = line_len; i >= 0; i--){
+		for (int i = line_len - 1; i >= 0; i--){
 			if (line[i] == '\n') {
 				line[i] = '\0';
 				break;
@@ -94,10 +399,14 @@ int main(int argc, char** argv) {
 		 * on error */
 		line_val = atoi(line);
 
-		printf("%i\n", line_val + ((flag_s) ? -1 : 1) * (flag_q));
+		value = line_val;
+		run_expr(e, &value, 1);
+		printf("%i\n", (int) value);
 
 	}
 
+	free(line);
+	free_expr(e);
 	return 0;
 
 }
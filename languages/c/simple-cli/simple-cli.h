@@ -39,6 +39,15 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <getopt.h> /* not in unistd.h for C89 */
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "fastio.h"
+#include "pipeline.h"
+#include "binary.h"
+#include "aggregate.h"
+#include "bench.h"
 
 int main(int argc, char** argv);
 
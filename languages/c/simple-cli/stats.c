@@ -0,0 +1,85 @@
+/* Copyright (c) 2018, Charles Daniels
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The counters behind --stats.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+
+#include <sys/resource.h>
+#include <time.h>
+
+double stats_clock(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void merge_io_stats(io_stats* into, const io_stats* from) {
+	into->values += from->values;
+	into->bytes_in += from->bytes_in;
+	into->bytes_out += from->bytes_out;
+	into->read += from->read;
+	into->parse += from->parse;
+	into->compute += from->compute;
+	into->format += from->format;
+	into->write += from->write;
+}
+
+static void print_stage(const char* name, double seconds, double wall, FILE* stream) {
+	fprintf(stream, "%-10s %10.3f s %6.1f%%\n", name, seconds,
+			(wall > 0) ? 100 * seconds / wall : 0.0);
+}
+
+void print_io_stats(const io_stats* s, double wall, FILE* stream) {
+	struct rusage usage;
+	double rate = (wall > 0) ? 1 / wall : 0;
+
+	fprintf(stream, "values     %10llu   %.3g/s\n",
+			(unsigned long long) s->values, s->values * rate);
+	fprintf(stream, "bytes in   %10llu   %.3g MB/s\n",
+			(unsigned long long) s->bytes_in, s->bytes_in * rate / 1e6);
+	fprintf(stream, "bytes out  %10llu   %.3g MB/s\n",
+			(unsigned long long) s->bytes_out, s->bytes_out * rate / 1e6);
+	print_stage("wall", wall, wall, stream);
+	print_stage("read", s->read, wall, stream);
+	print_stage("parse", s->parse, wall, stream);
+	print_stage("compute", s->compute, wall, stream);
+	print_stage("format", s->format, wall, stream);
+	print_stage("write", s->write, wall, stream);
+
+	/* ru_maxrss is in kilobytes on Linux */
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		fprintf(stream, "peak rss   %10.1f MB\n", usage.ru_maxrss / 1024.0);
+	}
+}
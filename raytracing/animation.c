@@ -0,0 +1,72 @@
+#include "util.h"
+#include "ray.h"
+#include "vec.h"
+#include "hit.h"
+#include "camera.h"
+#include "render.h"
+
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This is not from the book. It renders a short fly past of the Listing 29
+ * scene as a sequence of HIF24 images, animation000.hif24 and so on, in a
+ * single process (see render_animation() in render.h).
+ *
+ * usage: animation [frames] [samples per pixel]
+ */
+
+int main(int argc, char** argv) {
+	animation_opts opts = (animation_opts) {
+		.width = 400,
+		.height = 200,
+		.frames = (argc > 1) ? atoi(argv[1]) : 24,
+		.samples_per_pixel = (argc > 2) ? atoi(argv[2]) : 16,
+		.path = "animation%03i.hif24",
+		.verbose = true
+	};
+
+	hitobj world[3];
+	world[0] = (hitobj) {
+		.type = HITTABLE_SPHERE,
+		.center = vec3make(0, 0, -1),
+		.radius = 0.5
+	};
+	world[1] = (hitobj) {
+		.type = HITTABLE_SPHERE,
+		.center = vec3make(0, -100.5, -1),
+		.radius = 100
+	};
+	world[2].type = HITTABLE_NULL;
+
+	/* slide from left to right, rising up at the end */
+	camera_key keys[3];
+	keys[0] = (camera_key) {.time = 0, .cam = (camera) {
+		.lower_left_corner = vec3make(-3, -1, -1),
+		.horizontal = vec3make(4, 0, 0),
+		.vertical = vec3make(0, 2, 0),
+		.origin = vec3make(-1, 0, 0)
+	}};
+	keys[1] = (camera_key) {.time = 1, .cam = (camera) {
+		.lower_left_corner = vec3make(-1, -1, -1),
+		.horizontal = vec3make(4, 0, 0),
+		.vertical = vec3make(0, 2, 0),
+		.origin = vec3make(1, 0, 0)
+	}};
+	keys[2] = (camera_key) {.time = 1.5, .cam = (camera) {
+		.lower_left_corner = vec3make(-1, -0.5, -1),
+		.horizontal = vec3make(4, 0, 0),
+		.vertical = vec3make(0, 2, 0),
+		.origin = vec3make(1, 0.5, 0)
+	}};
+
+	scene sc = (scene) {
+		.world = &(world[0]),
+		.ray_color = ray_color_normals
+	};
+
+	render_animation(&sc, keys, 3, opts);
+	printf("DONE\n");
+}
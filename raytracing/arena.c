@@ -0,0 +1,143 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ */
+
+#include "util.h"
+#include "arena.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+static size_t round_up(size_t n, size_t to) {
+	return (n + to - 1) / to * to;
+}
+
+static arena_block* map_block(size_t size, int flags) {
+	size_t page = (flags & ARENA_HUGEPAGES) ?
+		ARENA_HUGE_PAGE_SIZE : (size_t) sysconf(_SC_PAGESIZE);
+	size = round_up(size, page);
+
+	/* huge pages can only back regions aligned to a huge page, so map
+	 * one huge page extra and trim off both ends */
+	size_t map_size = (flags & ARENA_HUGEPAGES) ? size + page : size;
+	uint8_t* p = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ((p == MAP_FAILED) && (flags & ARENA_MAY_FAIL)) {
+		return NULL;
+	}
+	if (p == MAP_FAILED) {
+		abort("failed to map %zu bytes: %s\n", map_size, strerror(errno));
+	}
+
+	if (flags & ARENA_HUGEPAGES) {
+		uint8_t* start = (uint8_t*) round_up((uintptr_t) p, page);
+		if (start > p) {
+			munmap(p, start - p);
+		}
+		munmap(start + size, (p + map_size) - (start + size));
+		p = start;
+
+		/* only a hint, kernels without transparent huge pages just
+		 * use normal ones */
+		madvise(p, size, MADV_HUGEPAGE);
+	}
+
+	arena_block* b = (arena_block*) p;
+	b->prev = NULL;
+	b->size = size;
+	b->used = sizeof(arena_block);
+	return b;
+}
+
+static void unmap_blocks(arena* a) {
+	while (a->head != NULL) {
+		arena_block* prev = a->head->prev;
+		munmap(a->head, a->head->size);
+		a->head = prev;
+	}
+	a->mapped = 0;
+}
+
+arena* alloc_arena(size_t block_size, int flags) {
+	arena* a = malloc(sizeof(arena));
+	a->head = NULL;
+	a->block_size = (block_size > 0) ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+	a->used = 0;
+	a->high_water = 0;
+	a->mapped = 0;
+	a->flags = flags;
+	return a;
+}
+
+void free_arena(arena* a) {
+	unmap_blocks(a);
+	free(a);
+}
+
+void* arena_alloc(arena* a, size_t size, size_t align) {
+	if (align == 0) {
+		align = ARENA_DEFAULT_ALIGN;
+	}
+	if ((align & (align - 1)) != 0) {
+		abort("alignment %zu is not a power of two\n", align);
+	}
+
+	arena_block* b = a->head;
+	if (b != NULL) {
+		uintptr_t base = (uintptr_t) b;
+		uintptr_t start = round_up(base + b->used, align);
+		if (start + size <= base + b->size) {
+			a->used += start + size - (base + b->used);
+			b->used = start + size - base;
+			if (a->used > a->high_water) {
+				a->high_water = a->used;
+			}
+			return (void*) start;
+		}
+	}
+
+	/* grow by at least as much as is already mapped, so the number of
+	 * blocks stays logarithmic in the size of a frame */
+	size_t need = sizeof(arena_block) + align + size;
+	size_t block_size = a->block_size;
+	if (block_size < a->mapped) {
+		block_size = a->mapped;
+	}
+	if (block_size < need) {
+		block_size = need;
+	}
+
+	arena_block* grown = map_block(block_size, a->flags);
+	if (grown == NULL) {
+		return NULL;
+	}
+	grown->prev = a->head;
+	a->head = grown;
+	a->mapped += grown->size;
+	return arena_alloc(a, size, align);
+}
+
+void arena_reset(arena* a) {
+	if ((a->head != NULL) && (a->head->prev != NULL)) {
+		/* leave some room for allocations to be padded differently
+		 * next time around */
+		size_t size = sizeof(arena_block) + a->high_water + a->high_water / 8;
+		unmap_blocks(a);
+		a->head = map_block(size, a->flags);
+		a->mapped = (a->head != NULL) ? a->head->size : 0;
+	} else if (a->head != NULL) {
+		a->head->used = sizeof(arena_block);
+	}
+	a->used = 0;
+}
+
+size_t arena_high_water(arena* a) {
+	return a->high_water;
+}
@@ -0,0 +1,73 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This file implements an arena (bump) allocator for scratch memory that
+ * lives for one frame, pass or job. Allocating is just moving a pointer
+ * forward, and everything is given back at once by arena_reset(), so a
+ * renderer that resets its arena every frame does not call malloc() at all
+ * once the arena has grown big enough to hold a whole frame.
+ *
+ * An arena is not locked, each thread should have its own.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* alignment used when none is asked for, enough for any scalar type */
+#define ARENA_DEFAULT_ALIGN 16
+
+/* size of a transparent huge page on x86-64 and aarch64 with 4K pages */
+#define ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* back blocks with huge pages where the kernel allows it, see
+ * madvise(MADV_HUGEPAGE). Worth it for arenas of several megabytes that are
+ * touched all over, like image sized buffers. */
+#define ARENA_HUGEPAGES 1
+
+/* if memory can't be mapped, arena_alloc() returns NULL rather than aborting.
+ * For servers, where one request that is too big must not take down the
+ * rest. */
+#define ARENA_MAY_FAIL 2
+
+/* one mapping which allocations are carved out of, the header sits at the
+ * start of it */
+typedef struct arena_block_t {
+	struct arena_block_t* prev;
+	size_t size;		/* including this header */
+	size_t used;		/* including this header */
+} arena_block;
+
+typedef struct arena_t {
+	arena_block* head;	/* allocations come from here */
+	size_t block_size;	/* smallest block to map when growing */
+	size_t used;		/* bytes handed out since the last reset */
+	size_t high_water;	/* most bytes ever handed out between resets */
+	size_t mapped;		/* bytes currently mapped, over all blocks */
+	int flags;
+} arena;
+
+/* block_size is only a starting point, the arena grows as needed. 0 picks a
+ * default. */
+arena* alloc_arena(size_t block_size, int flags);
+void free_arena(arena* a);
+
+/* returns size bytes aligned to align, which must be a power of two, or 0 for
+ * ARENA_DEFAULT_ALIGN. The memory is not cleared. Returns NULL if a has
+ * ARENA_MAY_FAIL and there is not enough memory. */
+void* arena_alloc(arena* a, size_t size, size_t align);
+
+/* gives back everything allocated from a. If the last frame needed more than
+ * one block, they are replaced by a single block big enough for all of it,
+ * so that the next frame of the same size fits without growing. */
+void arena_reset(arena* a);
+
+/* most bytes in use at once since a was made, including alignment padding */
+size_t arena_high_water(arena* a);
+
+#endif /* ARENA_H */
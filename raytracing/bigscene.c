@@ -0,0 +1,63 @@
+#include "raytrace.h"
+
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This is not from the book. It renders a quick preview of a scene made of a
+ * large number of small spheres. The BVH for the scene is cached on disk (see
+ * bvhcache.h), so only the first run has to build it.
+ *
+ * usage: bigscene [number of spheres] [cache directory]
+ */
+
+int main(int argc, char** argv) {
+	const int image_width = 200;
+	const int image_height = 100;
+	const int samples_per_pixel = 4;
+	int count = (argc > 1) ? atoi(argv[1]) : 200000;
+	char* cache_dir = (argc > 2) ? argv[2] : ".";
+
+	image* im = alloc_image(image_width, image_height, (color) {.r = 0, .g = 0, .b = 0});
+
+	/* the same every run, since drand() is never seeded */
+	hitobj* objs = malloc(sizeof(hitobj) * (count + 1));
+	for (int i = 0 ; i < count ; i++) {
+		objs[i] = (hitobj) {
+			.type = HITTABLE_SPHERE,
+			.center = vec3make(8 * drand() - 4, 4 * drand() - 2, -2 - 6 * drand()),
+			.radius = 0.01 + 0.02 * drand()
+		};
+	}
+	objs[count].type = HITTABLE_NULL;
+
+	double start = render_clock();
+	bvh* b = bvh_build_cached(objs, cache_dir);
+	printf("BVH over %i spheres ready in %.3fs\n", count, render_clock() - start);
+
+	hitobj world[2];
+	world[0] = bvh_hitobj(b);
+	world[1].type = HITTABLE_NULL;
+
+	scene sc = (scene) {
+		.cam = (camera) {
+			.lower_left_corner = vec3make(-2, -1, -1),
+			.horizontal = vec3make(4, 0, 0),
+			.vertical = vec3make(0, 2, 0),
+			.origin = vec3make(0, 0, 0)
+		},
+		.world = &(world[0]),
+		.ray_color = ray_color_normals
+	};
+
+	start = render_clock();
+	render(&sc, im, samples_per_pixel);
+	printf("rendered in %.3fs\n", render_clock() - start);
+
+	write_image(im, OUTFILE);
+	bvh_free(b);
+	free(objs);
+	free_image(im);
+}
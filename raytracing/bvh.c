@@ -0,0 +1,188 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ */
+
+#include "bvh.h"
+
+#include <sys/mman.h>
+
+typedef struct {
+	aabb box;
+	vec3 centroid;
+	uint32_t index;
+} primref;
+
+static int primref_cmp_x(const void* a, const void* b) {
+	double ca = ((const primref*) a)->centroid.x;
+	double cb = ((const primref*) b)->centroid.x;
+	return (ca > cb) - (ca < cb);
+}
+
+static int primref_cmp_y(const void* a, const void* b) {
+	double ca = ((const primref*) a)->centroid.y;
+	double cb = ((const primref*) b)->centroid.y;
+	return (ca > cb) - (ca < cb);
+}
+
+static int primref_cmp_z(const void* a, const void* b) {
+	double ca = ((const primref*) a)->centroid.z;
+	double cb = ((const primref*) b)->centroid.z;
+	return (ca > cb) - (ca < cb);
+}
+
+/* builds the subtree over refs[start, start+count) and returns its index */
+static uint32_t bvh_build_node(bvh* b, primref* refs, uint32_t start, uint32_t count) {
+	uint32_t index = b->nnodes++;
+	aabb box = refs[start].box;
+	aabb cbox = {.min = refs[start].centroid, .max = refs[start].centroid};
+
+	for (uint32_t i = start + 1 ; i < start + count ; i++) {
+		box = aabb_union(box, refs[i].box);
+		cbox = aabb_union(cbox,
+			(aabb) {.min = refs[i].centroid, .max = refs[i].centroid});
+	}
+
+	b->nodes[index].box = box;
+
+	if (count <= BVH_LEAF_SIZE) {
+		b->nodes[index].start = start;
+		b->nodes[index].count = count;
+		b->nodes[index].axis = 0;
+		return index;
+	}
+
+	/* median split along the axis where the centroids are most spread
+	 * out */
+	vec3 extent = vec3sub(cbox.max, cbox.min);
+	uint16_t axis = 0;
+	if (extent.y > extent.x) { axis = 1; }
+	if (extent.z > (axis == 0 ? extent.x : extent.y)) { axis = 2; }
+
+	int (*cmp[3])(const void*, const void*) = {
+		primref_cmp_x, primref_cmp_y, primref_cmp_z
+	};
+	qsort(&(refs[start]), count, sizeof(primref), cmp[axis]);
+
+	uint32_t mid = count / 2;
+	bvh_build_node(b, refs, start, mid);
+	uint32_t right = bvh_build_node(b, refs, start + mid, count - mid);
+
+	b->nodes[index].start = right;
+	b->nodes[index].count = 0;
+	b->nodes[index].axis = axis;
+	return index;
+}
+
+bvh* bvh_build(hitobj* objs) {
+	uint32_t n = 0;
+	while (objs[n].type != HITTABLE_NULL) { n++; }
+
+	bvh* b = malloc(sizeof(bvh));
+	b->nprims = n;
+	b->nnodes = 0;
+	b->mapping = NULL;
+	b->mapping_size = 0;
+	b->prims = malloc(sizeof(hitobj) * (n + 1));
+	b->nodes = malloc(sizeof(bvhnode) * (n > 0 ? 2 * n - 1 : 1));
+
+	if (n == 0) {
+		b->prims[0].type = HITTABLE_NULL;
+		return b;
+	}
+
+	primref* refs = malloc(sizeof(primref) * n);
+	for (uint32_t i = 0 ; i < n ; i++) {
+		refs[i].box = hitbounds(objs[i]);
+		refs[i].centroid = aabb_centroid(refs[i].box);
+		refs[i].index = i;
+	}
+
+	bvh_build_node(b, refs, 0, n);
+
+	for (uint32_t i = 0 ; i < n ; i++) {
+		b->prims[i] = objs[refs[i].index];
+	}
+	b->prims[n].type = HITTABLE_NULL;
+
+	free(refs);
+	return b;
+}
+
+void bvh_free(bvh* b) {
+	if (b->mapping != NULL) {
+		munmap(b->mapping, b->mapping_size);
+	} else {
+		free(b->nodes);
+		free(b->prims);
+	}
+	free(b);
+}
+
+bool bvh_hit(bvh* b, ray r, double t_min, double t_max, hitrec* rec) {
+	uint32_t stack[BVH_STACK_SIZE];
+	int sp = 0;
+	hitrec temprec;
+	bool hitany = false;
+	double closest = t_max;
+
+	if (b->nnodes == 0) {
+		return false;
+	}
+
+	vec3 invdir = vec3make(1 / r.direction.x, 1 / r.direction.y,
+			1 / r.direction.z);
+	bool negative[3] = {invdir.x < 0, invdir.y < 0, invdir.z < 0};
+
+	stack[sp++] = 0;
+	while (sp > 0) {
+		uint32_t index = stack[--sp];
+		bvhnode* n = &(b->nodes[index]);
+
+		if (!aabb_hit(n->box, r, invdir, t_min, closest)) {
+			continue;
+		}
+
+		if (n->count > 0) {
+			for (uint32_t i = n->start ; i < n->start + n->count ; i++) {
+				if (hit(b->prims[i], r, t_min, closest, &temprec)) {
+					hitany = true;
+					closest = temprec.t;
+					if (rec != NULL) {
+						*rec = temprec;
+					}
+				}
+			}
+		} else {
+			/* push the far child first so the near one is visited
+			 * first, which shrinks closest sooner */
+			if (negative[n->axis]) {
+				stack[sp++] = index + 1;
+				stack[sp++] = n->start;
+			} else {
+				stack[sp++] = n->start;
+				stack[sp++] = index + 1;
+			}
+		}
+	}
+
+	return hitany;
+}
+
+aabb bvh_bounds(bvh* b) {
+	if (b->nnodes == 0) {
+		return (aabb) {.min = vec3make(0, 0, 0), .max = vec3make(0, 0, 0)};
+	}
+	return b->nodes[0].box;
+}
+
+hitobj bvh_hitobj(bvh* b) {
+	return (hitobj) {.type = HITTABLE_BVH, .bvh = b};
+}
+
+size_t bvh_size(bvh* b) {
+	return sizeof(bvh) + sizeof(bvhnode) * b->nnodes +
+		sizeof(hitobj) * (b->nprims + 1);
+}
@@ -0,0 +1,61 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This file implements a bounding volume hierarchy (BVH), which lets us test
+ * a ray against a large number of objects without visiting all of them.
+ *
+ * A BVH is itself a hitobj (HITTABLE_BVH), and can contain any other kind of
+ * hitobj, including instances (see instance.h) which in turn point at another
+ * BVH. That is how the two level scheme works: a top level BVH over instances,
+ * and one bottom level BVH per unique piece of geometry.
+ */
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <stdint.h>
+
+#include "hit.h"
+
+/* maximum number of primitives in a leaf node */
+#define BVH_LEAF_SIZE 4
+
+/* maximum depth of the traversal stack, the median split used by bvh_build()
+ * keeps the tree balanced so this is never approached in practice. A tree
+ * deeper than this could overflow it, so bvh_load() refuses one. */
+#define BVH_STACK_SIZE 64
+
+/* nodes are stored depth first, so the left child of an interior node is
+ * always the node immediately after it */
+typedef struct {
+	aabb box;
+	uint32_t start;		/* leaf: first primitive, interior: right child */
+	uint16_t count;		/* leaf: number of primitives, interior: 0 */
+	uint16_t axis;		/* interior: split axis, 0=x 1=y 2=z */
+} bvhnode;
+
+typedef struct bvh_t {
+	bvhnode* nodes;
+	hitobj* prims;		/* copy of the input, in leaf order */
+	uint32_t nnodes;
+	uint32_t nprims;
+	void* mapping;		/* if loaded from a file, what to munmap() */
+	size_t mapping_size;
+} bvh;
+
+/* objs is a HITTABLE_NULL terminated array, it is copied so the caller may
+ * free it afterwards */
+bvh* bvh_build(hitobj* objs);
+void bvh_free(bvh* b);
+bool bvh_hit(bvh* b, ray r, double t_min, double t_max, hitrec* rec);
+aabb bvh_bounds(bvh* b);
+hitobj bvh_hitobj(bvh* b);
+
+/* number of bytes of memory used by the BVH, not counting anything that its
+ * primitives point to */
+size_t bvh_size(bvh* b);
+
+#endif /* BVH_H */
@@ -0,0 +1,263 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ */
+
+#include "bvhcache.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* sections of the file start on a cache line */
+#define BVHCACHE_ALIGN 64
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t fnv1a(uint64_t h, const void* data, size_t len) {
+	const uint8_t* p = data;
+	for (size_t i = 0 ; i < len ; i++) {
+		h ^= p[i];
+		h *= FNV_PRIME;
+	}
+	return h;
+}
+
+uint64_t hitobj_hash(hitobj* objs) {
+	uint64_t h = FNV_OFFSET;
+	uint32_t n = 0;
+
+	/* hash field by field, since hitobj has padding in it */
+	for (n = 0 ; objs[n].type != HITTABLE_NULL ; n++) {
+		if (objs[n].type != HITTABLE_SPHERE) {
+			return 0;
+		}
+		uint32_t type = objs[n].type;
+		h = fnv1a(h, &type, sizeof(type));
+		h = fnv1a(h, &(objs[n].center), sizeof(vec3));
+		h = fnv1a(h, &(objs[n].radius), sizeof(double));
+	}
+	h = fnv1a(h, &n, sizeof(n));
+
+	return (h == 0) ? 1 : h;
+}
+
+/* An order independent hash of the n spheres in objs: the sum of a hash of
+ * each. bvh_build() reorders the primitives, so a cached BVH's prims are the
+ * same multiset as its input but not in the same order. */
+static uint64_t sphere_set_hash(hitobj* objs, uint32_t n) {
+	uint64_t sum = 0;
+	for (uint32_t i = 0 ; i < n ; i++) {
+		uint64_t h = fnv1a(FNV_OFFSET, &(objs[i].center), sizeof(vec3));
+		sum += fnv1a(h, &(objs[i].radius), sizeof(double));
+	}
+	return sum;
+}
+
+static uint64_t align_up(uint64_t x) {
+	return (x + BVHCACHE_ALIGN - 1) & ~((uint64_t) BVHCACHE_ALIGN - 1);
+}
+
+bool bvh_save(bvh* b, uint64_t hash, char* path) {
+	bvhcache_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, BVHCACHE_MAGIC, sizeof(hdr.magic));
+	hdr.version = BVHCACHE_VERSION;
+	hdr.byte_order = 0x01020304;
+	hdr.node_size = sizeof(bvhnode);
+	hdr.hitobj_size = sizeof(hitobj);
+	hdr.hash = hash;
+	hdr.nnodes = b->nnodes;
+	hdr.nprims = b->nprims;
+	hdr.nodes_offset = align_up(sizeof(hdr));
+	hdr.prims_offset = align_up(hdr.nodes_offset + sizeof(bvhnode) * (uint64_t) b->nnodes);
+	hdr.file_size = hdr.prims_offset + sizeof(hitobj) * ((uint64_t) b->nprims + 1);
+
+	/* write somewhere else and rename it into place, so that nobody ever
+	 * maps a half written file. Threads of one process may be saving the
+	 * same BVH at once, so each save gets its own file. */
+	static atomic_ulong saves;
+	size_t len = strlen(path) + 64;
+	char* tmp = malloc(len);
+	snprintf(tmp, len, "%s.%ld.%lu.tmp", path, (long) getpid(),
+			atomic_fetch_add(&saves, 1));
+
+	FILE* fp = fopen(tmp, "w");
+	if (fp == NULL) {
+		free(tmp);
+		return false;
+	}
+
+	static const uint8_t zeros[BVHCACHE_ALIGN] = {0};
+	bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+	ok = ok && fwrite(zeros, 1, hdr.nodes_offset - sizeof(hdr), fp) ==
+		hdr.nodes_offset - sizeof(hdr);
+	ok = ok && fwrite(b->nodes, sizeof(bvhnode), b->nnodes, fp) == b->nnodes;
+	uint64_t pad = hdr.prims_offset - hdr.nodes_offset - sizeof(bvhnode) * (uint64_t) b->nnodes;
+	ok = ok && fwrite(zeros, 1, pad, fp) == pad;
+	ok = ok && fwrite(b->prims, sizeof(hitobj), b->nprims + 1, fp) == b->nprims + 1;
+	ok = (fclose(fp) == 0) && ok;
+	ok = ok && (rename(tmp, path) == 0);
+
+	if (!ok) {
+		unlink(tmp);
+	}
+	free(tmp);
+	return ok;
+}
+
+/* Walks the tree in the order bvh_build() lays it out, a node, then its left
+ * subtree, then its right. Every node must turn up exactly once and in that
+ * order, so no two parents share a child and there are no loops, and no
+ * node may be BVH_STACK_SIZE or more levels down. bvh_hit() then never needs
+ * more than BVH_STACK_SIZE entries of stack. */
+static bool bvh_shape_valid(bvh* b) {
+	uint32_t stack[BVH_STACK_SIZE];
+	int depth[BVH_STACK_SIZE];
+	int sp = 0;
+	uint32_t next = 0;
+
+	stack[sp] = 0;
+	depth[sp++] = 0;
+	while (sp > 0) {
+		sp--;
+		uint32_t index = stack[sp];
+		int d = depth[sp];
+		if (index != next) {
+			return false;
+		}
+		next++;
+
+		bvhnode* n = &(b->nodes[index]);
+		if (n->count > 0) {
+			continue;
+		}
+		if (d + 1 >= BVH_STACK_SIZE) {
+			return false;
+		}
+		stack[sp] = n->start;
+		depth[sp++] = d + 1;
+		stack[sp] = index + 1;
+		depth[sp++] = d + 1;
+	}
+
+	return next == b->nnodes;
+}
+
+/* checks that every index in the tree is in range and that the tree is
+ * shaped like one bvh_build() makes, so that a damaged file can't send
+ * bvh_hit() off into the weeds */
+static bool bvh_valid(bvh* b) {
+	if ((b->nprims == 0) != (b->nnodes == 0)) {
+		return false;
+	}
+	if ((b->nprims > 0) && (b->nnodes > 2 * b->nprims - 1)) {
+		return false;
+	}
+
+	for (uint32_t i = 0 ; i < b->nnodes ; i++) {
+		bvhnode* n = &(b->nodes[i]);
+		if (n->count > 0) {
+			if ((uint64_t) n->start + n->count > b->nprims) {
+				return false;
+			}
+		} else if ((n->start <= i + 1) || (n->start >= b->nnodes) ||
+				(n->axis > 2)) {
+			/* children always come after their parent */
+			return false;
+		}
+	}
+
+	if ((b->nnodes > 0) && !bvh_shape_valid(b)) {
+		return false;
+	}
+
+	for (uint32_t i = 0 ; i < b->nprims ; i++) {
+		if (b->prims[i].type != HITTABLE_SPHERE) {
+			return false;
+		}
+	}
+	return b->prims[b->nprims].type == HITTABLE_NULL;
+}
+
+bvh* bvh_load(char* path, uint64_t hash, hitobj* objs) {
+	struct stat st;
+	bvhcache_header hdr;
+	uint32_t nprims = 0;
+
+	while (objs[nprims].type != HITTABLE_NULL) { nprims++; }
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	if ((fstat(fd, &st) != 0) || ((size_t) st.st_size < sizeof(hdr))) {
+		close(fd);
+		return NULL;
+	}
+
+	void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return NULL;
+	}
+
+	memcpy(&hdr, map, sizeof(hdr));
+	bool ok = (memcmp(hdr.magic, BVHCACHE_MAGIC, sizeof(hdr.magic)) == 0) &&
+		(hdr.version == BVHCACHE_VERSION) &&
+		(hdr.byte_order == 0x01020304) &&
+		(hdr.node_size == sizeof(bvhnode)) &&
+		(hdr.hitobj_size == sizeof(hitobj)) &&
+		(hdr.hash == hash) &&
+		(hdr.nprims == nprims) &&
+		(hdr.file_size == (uint64_t) st.st_size) &&
+		(hdr.nodes_offset % BVHCACHE_ALIGN == 0) &&
+		(hdr.prims_offset % BVHCACHE_ALIGN == 0) &&
+		(hdr.nodes_offset + sizeof(bvhnode) * (uint64_t) hdr.nnodes <= hdr.prims_offset) &&
+		(hdr.prims_offset + sizeof(hitobj) * ((uint64_t) hdr.nprims + 1) <= hdr.file_size);
+
+	bvh* b = malloc(sizeof(bvh));
+	b->nodes = (bvhnode*) ((uint8_t*) map + hdr.nodes_offset);
+	b->prims = (hitobj*) ((uint8_t*) map + hdr.prims_offset);
+	b->nnodes = hdr.nnodes;
+	b->nprims = hdr.nprims;
+	b->mapping = map;
+	b->mapping_size = st.st_size;
+
+	/* the key is only a hash, make sure that the spheres really are the
+	 * ones asked for */
+	if (!ok || !bvh_valid(b) || (sphere_set_hash(b->prims, b->nprims) !=
+				sphere_set_hash(objs, nprims))) {
+		bvh_free(b);
+		return NULL;
+	}
+
+	return b;
+}
+
+bvh* bvh_build_cached(hitobj* objs, char* cache_dir) {
+	uint64_t hash = hitobj_hash(objs);
+	if (hash == 0) {
+		return bvh_build(objs);
+	}
+
+	size_t len = strlen(cache_dir) + 32;
+	char* path = malloc(len);
+	snprintf(path, len, "%s/%016llx.bvh", cache_dir, (unsigned long long) hash);
+
+	bvh* b = bvh_load(path, hash, objs);
+	if (b == NULL) {
+		b = bvh_build(objs);
+		bvh_save(b, hash, path);
+	}
+
+	free(path);
+	return b;
+}
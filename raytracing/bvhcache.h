@@ -0,0 +1,58 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This file implements saving a BVH to disk and loading it back with mmap(),
+ * so that large scenes only have to have their BVH built once. Nodes refer
+ * to each other and to primitives by index, so the file can be used directly
+ * wherever it is mapped.
+ *
+ * Cached BVHs are keyed by a hash of the objects they were built from, and
+ * checked when they are loaded, including that they hold the same spheres. Anything that doesn't check out is ignored
+ * and built again.
+ *
+ * Only BVHs made entirely of spheres can be cached, as other kinds of hitobj
+ * point at things which would not be at the same place next time.
+ */
+
+#ifndef BVHCACHE_H
+#define BVHCACHE_H
+
+#include "util.h"
+#include "bvh.h"
+
+#define BVHCACHE_MAGIC "RTBVH\r\n"
+#define BVHCACHE_VERSION 1
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;	/* 0x01020304 as written by the host */
+	uint32_t node_size;	/* sizeof(bvhnode) */
+	uint32_t hitobj_size;	/* sizeof(hitobj) */
+	uint64_t hash;		/* hitobj_hash() of the input */
+	uint32_t nnodes;
+	uint32_t nprims;
+	uint64_t nodes_offset;
+	uint64_t prims_offset;	/* prims includes the null terminator */
+	uint64_t file_size;
+} bvhcache_header;
+
+/* hash of the geometry in a HITTABLE_NULL terminated array, or 0 if it
+ * contains anything that can't be cached */
+uint64_t hitobj_hash(hitobj* objs);
+
+/* Like bvh_build(), but looks in cache_dir for a BVH built from the same
+ * objects first, and saves the result there if there wasn't one. */
+bvh* bvh_build_cached(hitobj* objs, char* cache_dir);
+
+/* returns false if the file could not be written */
+bool bvh_save(bvh* b, uint64_t hash, char* path);
+
+/* returns NULL if the file is missing, damaged, or not a BVH of exactly the
+ * spheres in objs, which hash to hash */
+bvh* bvh_load(char* path, uint64_t hash, hitobj* objs);
+
+#endif /* BVHCACHE_H */
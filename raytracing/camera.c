@@ -19,3 +19,161 @@ ray camera_get_ray(camera cam, double u, double v) {
 				cam.origin)
 	};
 }
+
+camera camera_lerp(camera a, camera b, double t) {
+	return (camera) {
+		.lower_left_corner = vec3sum(vec3mult(a.lower_left_corner, 1 - t),
+				vec3mult(b.lower_left_corner, t)),
+		.horizontal = vec3sum(vec3mult(a.horizontal, 1 - t),
+				vec3mult(b.horizontal, t)),
+		.vertical = vec3sum(vec3mult(a.vertical, 1 - t),
+				vec3mult(b.vertical, t)),
+		.origin = vec3sum(vec3mult(a.origin, 1 - t),
+				vec3mult(b.origin, t)),
+		.lens_radius = a.lens_radius * (1 - t) + b.lens_radius * t
+	};
+}
+
+camera camera_path_at(camera_key* keys, int nkeys, double time) {
+	if (nkeys <= 0) {
+		abort("camera path has no keyframes\n%s", "");
+	}
+
+	if (time <= keys[0].time) {
+		return keys[0].cam;
+	}
+
+	for (int i = 1 ; i < nkeys ; i++) {
+		if (time < keys[i].time) {
+			double t = (time - keys[i-1].time) /
+				(keys[i].time - keys[i-1].time);
+			return camera_lerp(keys[i-1].cam, keys[i].cam, t);
+		}
+	}
+
+	return keys[nkeys-1].cam;
+}
+
+raygen raygen_make(camera cam, uint16_t width, uint16_t height) {
+	return (raygen) {
+		.origin = cam.origin,
+		.corner = vec3sub(cam.lower_left_corner, cam.origin),
+		.du = vec3div(cam.horizontal, width),
+		.dv = vec3div(cam.vertical, height),
+		.lens_u = vec3mult(vec3unit(cam.horizontal), cam.lens_radius),
+		.lens_v = vec3mult(vec3unit(cam.vertical), cam.lens_radius),
+		.thin_lens = cam.lens_radius > 0,
+		.width = width,
+		.height = height
+	};
+}
+
+/* offset from the centre of the lens to a uniformly random point on it */
+static vec3 lens_offset(raygen* g, rngstate* rng) {
+	double x, y;
+	do {
+		x = 2 * drand_r(rng) - 1;
+		y = 2 * drand_r(rng) - 1;
+	} while (x * x + y * y >= 1);
+	return vec3sum(vec3mult(g->lens_u, x), vec3mult(g->lens_v, y));
+}
+
+ray raygen_ray(raygen* g, double x, double y, rngstate* rng) {
+	vec3 direction = vec3sum(g->corner,
+			vec3sum(vec3mult(g->du, x), vec3mult(g->dv, y)));
+
+	if (g->thin_lens && (rng != NULL)) {
+		/* aim at the same point on the focal plane from somewhere
+		 * else on the lens */
+		vec3 offset = lens_offset(g, rng);
+		return raymake(vec3sum(g->origin, offset), vec3sub(direction, offset));
+	}
+
+	return raymake(g->origin, direction);
+}
+
+int raygen_row(raygen* g, int row, int col, int ncols, int samples_per_pixel,
+		rngstate* rng, raybatch* out) {
+	int n = 0;
+
+	/* the direction through the lower left corner of the first pixel,
+	 * each pixel after that is one more du along */
+	vec3 base = vec3sum(g->corner,
+			vec3sum(vec3mult(g->du, col), vec3mult(g->dv, row)));
+
+	for (int i = 0 ; i < ncols ; i++) {
+		for (int s = 0 ; (s < samples_per_pixel) && (n < out->capacity) ; s++) {
+			double jx = (rng != NULL) ? drand_r(rng) : 0.5;
+			double jy = (rng != NULL) ? drand_r(rng) : 0.5;
+			vec3 o = g->origin;
+			vec3 d = vec3sum(base, vec3sum(vec3mult(g->du, jx), vec3mult(g->dv, jy)));
+
+			if (g->thin_lens && (rng != NULL)) {
+				vec3 offset = lens_offset(g, rng);
+				o = vec3sum(o, offset);
+				d = vec3sub(d, offset);
+			}
+
+			out->ox[n] = o.x;
+			out->oy[n] = o.y;
+			out->oz[n] = o.z;
+			out->dx[n] = d.x;
+			out->dy[n] = d.y;
+			out->dz[n] = d.z;
+			n++;
+		}
+		base = vec3sum(base, g->du);
+	}
+
+	out->count = n;
+	return n;
+}
+
+raybatch* alloc_raybatch(int capacity) {
+	raybatch* batch = malloc(sizeof(raybatch));
+	/* aligned_alloc() needs a multiple of the alignment */
+	size_t bytes = sizeof(double) * capacity;
+	bytes = (bytes + RAYBATCH_ALIGN - 1) / RAYBATCH_ALIGN * RAYBATCH_ALIGN;
+
+	batch->ox = aligned_alloc(RAYBATCH_ALIGN, bytes);
+	batch->oy = aligned_alloc(RAYBATCH_ALIGN, bytes);
+	batch->oz = aligned_alloc(RAYBATCH_ALIGN, bytes);
+	batch->dx = aligned_alloc(RAYBATCH_ALIGN, bytes);
+	batch->dy = aligned_alloc(RAYBATCH_ALIGN, bytes);
+	batch->dz = aligned_alloc(RAYBATCH_ALIGN, bytes);
+	batch->count = 0;
+	batch->capacity = capacity;
+	return batch;
+}
+
+raybatch* alloc_raybatch_arena(arena* a, int capacity) {
+	raybatch* batch = arena_alloc(a, sizeof(raybatch), 0);
+	/* one allocation for all six arrays, each padded so that the next
+	 * is aligned too */
+	size_t stride = (capacity + RAYBATCH_ALIGN / sizeof(double) - 1) /
+		(RAYBATCH_ALIGN / sizeof(double)) * (RAYBATCH_ALIGN / sizeof(double));
+	double* arrays = arena_alloc(a, sizeof(double) * stride * 6, RAYBATCH_ALIGN);
+	if (batch == NULL || arrays == NULL) {
+		return NULL;
+	}
+
+	batch->ox = arrays;
+	batch->oy = arrays + stride;
+	batch->oz = arrays + stride * 2;
+	batch->dx = arrays + stride * 3;
+	batch->dy = arrays + stride * 4;
+	batch->dz = arrays + stride * 5;
+	batch->count = 0;
+	batch->capacity = capacity;
+	return batch;
+}
+
+void free_raybatch(raybatch* batch) {
+	free(batch->ox);
+	free(batch->oy);
+	free(batch->oz);
+	free(batch->dx);
+	free(batch->dy);
+	free(batch->dz);
+	free(batch);
+}
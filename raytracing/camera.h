@@ -13,14 +13,87 @@
 #include "util.h"
 #include "vec.h"
 #include "ray.h"
+#include "arena.h"
 
 typedef struct {
 	vec3 lower_left_corner;
 	vec3 horizontal;
 	vec3 vertical;
 	vec3 origin;
+	/* 0 for a pinhole camera. Otherwise rays start from a disc of this
+	 * radius around origin, and only things on the plane of
+	 * lower_left_corner, horizontal and vertical are in focus. Only rays
+	 * made by a raygen take this into account. */
+	double lens_radius;
 } camera;
 
+/* A ray generator, made from a camera for an image of a particular size. It
+ * makes rays for a pixel by adding multiples of per pixel steps to a
+ * precomputed starting direction, which is cheaper than camera_get_ray(). */
+typedef struct {
+	vec3 origin;
+	vec3 corner;		/* direction through the lower left corner */
+	vec3 du;		/* change in direction one pixel to the right */
+	vec3 dv;		/* change in direction one pixel up */
+	vec3 lens_u;		/* lens_radius along horizontal */
+	vec3 lens_v;		/* lens_radius along vertical */
+	bool thin_lens;
+	uint16_t width;
+	uint16_t height;
+} raygen;
+
+/* a batch of rays in structure of arrays form, for kernels that work on
+ * several rays at once. Each array is RAYBATCH_ALIGN byte aligned. */
+typedef struct {
+	double* ox;
+	double* oy;
+	double* oz;
+	double* dx;
+	double* dy;
+	double* dz;
+	int count;
+	int capacity;
+} raybatch;
+
+#define RAYBATCH_ALIGN 64
+
+/* a camera path is an array of keyframes sorted by time */
+typedef struct {
+	double time;
+	camera cam;
+} camera_key;
+
 ray camera_get_ray(camera cam, double u, double v);
 
+/* linear interpolation of every camera field, t=0 gives a and t=1 gives b */
+camera camera_lerp(camera a, camera b, double t);
+
+raygen raygen_make(camera cam, uint16_t width, uint16_t height);
+
+/* the ray through (x, y) in pixel units, e.g. (col + 0.5, row + 0.5) is the
+ * centre of a pixel. rng is only used for thin lens cameras. For more than
+ * the odd ray, raygen_row() is cheaper, it steps from pixel to pixel rather
+ * than working out each one from the corner. */
+ray raygen_ray(raygen* g, double x, double y, rngstate* rng);
+
+/* Replaces the contents of out with the rays for samples_per_pixel samples
+ * in each of ncols pixels starting at (row, col). The rays for a pixel are
+ * next to each other. If rng is NULL, every sample goes through the centre of
+ * its pixel, otherwise samples are jittered within it. Returns the number of
+ * rays written, which is limited by out->capacity. */
+int raygen_row(raygen* g, int row, int col, int ncols, int samples_per_pixel,
+		rngstate* rng, raybatch* out);
+
+raybatch* alloc_raybatch(int capacity);
+void free_raybatch(raybatch* batch);
+
+/* like alloc_raybatch(), but from the arena a, so it lives until a is reset
+ * and must not be passed to free_raybatch(). Returns NULL if a ran out of
+ * memory (see ARENA_MAY_FAIL). */
+raybatch* alloc_raybatch_arena(arena* a, int capacity);
+
+/* the camera at the given time along a path, times before the first or after
+ * the last keyframe are clamped to it */
+camera camera_path_at(camera_key* keys, int nkeys, double time);
+
 #endif /* CAMERA_H */
@@ -0,0 +1,263 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ */
+
+#include "denoise.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+/* The filter works on 4 horizontally adjacent pixels at a time, using GCC
+ * vector extensions so that it is vectorized on any target without
+ * intrinsics. All of the buffers are planar (one float per pixel per
+ * channel) so that 4 adjacent pixels are 4 adjacent floats. */
+typedef float v4f __attribute__((vector_size(16)));
+typedef float v4f_unaligned __attribute__((vector_size(16), aligned(4)));
+typedef int32_t v4i __attribute__((vector_size(16)));
+
+/* the normal weight is max(0, dot(n_p, n_q))^(2^NORMAL_SQUARINGS) */
+#define NORMAL_SQUARINGS 7
+
+/* depth stand in for pixels where the ray hit nothing */
+#define SKY_DEPTH 1e6f
+
+typedef struct {
+	v4f c[3];
+	v4f n[3];
+	v4f z;
+	v4f valid;		/* 1 if the lane is inside the image, else 0 */
+} lanes;
+
+typedef struct {
+	float* in[3];
+	float* out[3];
+	float* n[3];
+	float* z;
+	int width;
+	int height;
+	int step;
+	float inv_sigma_color2;
+	float inv_sigma_depth;
+} atrous_pass;
+
+typedef struct {
+	atrous_pass* pass;
+	int row_start;
+	int row_end;
+} atrous_job;
+
+denoise_opts denoise_defaults(void) {
+	return (denoise_opts) {
+		.iterations = 3,
+		.sigma_color = 0.2,
+		.sigma_depth = 0.05,
+		.threads = 0,
+		.scratch = NULL
+	};
+}
+
+static v4f v4splat(float f) {
+	return (v4f) {f, f, f, f};
+}
+
+static v4f v4max0(v4f x) {
+	v4i positive = x > v4splat(0);
+	return (v4f) (positive & (v4i) x);
+}
+
+static v4f v4abs(v4f x) {
+	return (v4f) ((v4i) x & (v4i) {0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff});
+}
+
+/* exp(-x) for x >= 0, as (1 - x/256)^256. This is within a few percent
+ * where it matters, and is just multiplies, so it vectorizes. Weights smaller
+ * than exp(-256) are rounded to 0. */
+static v4f v4expneg(v4f x) {
+	v4f e = v4max0(v4splat(1) - x * v4splat(1.0f / 256));
+	for (int i = 0 ; i < 8 ; i++) {
+		e = e * e;
+	}
+	return e;
+}
+
+/* loads pixels (row, col+dx) through (row, col+dx+3) */
+static lanes load_lanes(atrous_pass* p, int row, int col, int dx) {
+	lanes l;
+	int start = col + dx;
+
+	if ((row < 0) || (row >= p->height)) {
+		l.valid = v4splat(0);
+		return l;
+	}
+
+	if ((start >= 0) && (start + 3 < p->width)) {
+		int i = row * p->width + start;
+		for (int ch = 0 ; ch < 3 ; ch++) {
+			l.c[ch] = *((v4f_unaligned*) &(p->in[ch][i]));
+			l.n[ch] = *((v4f_unaligned*) &(p->n[ch][i]));
+		}
+		l.z = *((v4f_unaligned*) &(p->z[i]));
+		l.valid = v4splat(1);
+		return l;
+	}
+
+	/* near the left or right edge, gather one lane at a time */
+	for (int lane = 0 ; lane < 4 ; lane++) {
+		int x = start + lane;
+		bool inside = (x >= 0) && (x < p->width);
+		int i = row * p->width + (inside ? x : 0);
+		for (int ch = 0 ; ch < 3 ; ch++) {
+			l.c[ch][lane] = p->in[ch][i];
+			l.n[ch][lane] = p->n[ch][i];
+		}
+		l.z[lane] = p->z[i];
+		l.valid[lane] = inside ? 1 : 0;
+	}
+	return l;
+}
+
+static void atrous_group(atrous_pass* p, int row, int col) {
+	static const float kernel[5] = {1.0f/16, 1.0f/4, 3.0f/8, 1.0f/4, 1.0f/16};
+	lanes centre = load_lanes(p, row, col, 0);
+	v4f sum[3] = {v4splat(0), v4splat(0), v4splat(0)};
+	v4f wsum = v4splat(0);
+	v4f depth_scale = v4splat(p->inv_sigma_depth / p->step) / centre.z;
+
+	for (int ky = 0 ; ky < 5 ; ky++) {
+		int r = row + (ky - 2) * p->step;
+		if ((r < 0) || (r >= p->height)) {
+			continue;
+		}
+
+		for (int kx = 0 ; kx < 5 ; kx++) {
+			lanes tap = load_lanes(p, r, col, (kx - 2) * p->step);
+
+			v4f dc = v4splat(0);
+			v4f dn = v4splat(0);
+			for (int ch = 0 ; ch < 3 ; ch++) {
+				v4f d = centre.c[ch] - tap.c[ch];
+				dc += d * d;
+				dn += centre.n[ch] * tap.n[ch];
+			}
+
+			v4f wn = v4max0(dn);
+			for (int i = 0 ; i < NORMAL_SQUARINGS ; i++) {
+				wn = wn * wn;
+			}
+
+			v4f dz = v4abs(centre.z - tap.z) * depth_scale;
+
+			v4f w = v4splat(kernel[ky] * kernel[kx]) * tap.valid * wn *
+				v4expneg(dc * v4splat(p->inv_sigma_color2) + dz);
+
+			for (int ch = 0 ; ch < 3 ; ch++) {
+				sum[ch] += w * tap.c[ch];
+			}
+			wsum += w;
+		}
+	}
+
+	/* the centre tap always has a non-zero weight, so wsum is only 0 for
+	 * lanes past the right edge of the image */
+	for (int lane = 0 ; (lane < 4) && (col + lane < p->width) ; lane++) {
+		int i = row * p->width + col + lane;
+		for (int ch = 0 ; ch < 3 ; ch++) {
+			p->out[ch][i] = sum[ch][lane] / wsum[lane];
+		}
+	}
+}
+
+static void* atrous_worker(void* arg) {
+	atrous_job* job = (atrous_job*) arg;
+	for (int row = job->row_start ; row < job->row_end ; row++) {
+		for (int col = 0 ; col < job->pass->width ; col += 4) {
+			atrous_group(job->pass, row, col);
+		}
+	}
+	return NULL;
+}
+
+void denoise_image(image* im, gbuffer* gb, denoise_opts opts) {
+	if ((gb->width != im->width) || (gb->height != im->height)) {
+		abort("gbuffer is %ix%i but image is %ix%i\n",
+				gb->width, gb->height, im->width, im->height);
+	}
+
+	int n = im->width * im->height;
+	int threads = opts.threads;
+	if (threads <= 0) {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (threads > im->height) {
+		threads = im->height;
+	}
+
+	arena* scratch = opts.scratch;
+	if (scratch == NULL) {
+		scratch = alloc_arena(sizeof(float) * n * 10 + 4096, ARENA_HUGEPAGES);
+	}
+
+	/* one allocation for all 10 planes, aligned for v4f */
+	float* planes = arena_alloc(scratch, sizeof(float) * n * 10, sizeof(v4f));
+	atrous_pass p = {
+		.in = {&(planes[0]), &(planes[n]), &(planes[2 * n])},
+		.out = {&(planes[3 * n]), &(planes[4 * n]), &(planes[5 * n])},
+		.n = {&(planes[6 * n]), &(planes[7 * n]), &(planes[8 * n])},
+		.z = &(planes[9 * n]),
+		.width = im->width,
+		.height = im->height,
+		.inv_sigma_depth = 1 / opts.sigma_depth
+	};
+
+	for (int i = 0 ; i < n ; i++) {
+		p.in[0][i] = im->data[i].r / 255.0f;
+		p.in[1][i] = im->data[i].g / 255.0f;
+		p.in[2][i] = im->data[i].b / 255.0f;
+		p.n[0][i] = gb->normal[i].x;
+		p.n[1][i] = gb->normal[i].y;
+		p.n[2][i] = gb->normal[i].z;
+		p.z[i] = isfinite(gb->depth[i]) ? gb->depth[i] : SKY_DEPTH;
+	}
+
+	pthread_t* tids = arena_alloc(scratch, sizeof(pthread_t) * threads, 0);
+	atrous_job* jobs = arena_alloc(scratch, sizeof(atrous_job) * threads, 0);
+
+	for (int it = 0 ; it < opts.iterations ; it++) {
+		/* each iteration doubles the spacing between taps, and halves
+		 * how big of a color difference is tolerated */
+		float sigma_color = opts.sigma_color / (1 << it);
+		p.step = 1 << it;
+		p.inv_sigma_color2 = 1 / (sigma_color * sigma_color);
+
+		for (int t = 0 ; t < threads ; t++) {
+			jobs[t] = (atrous_job) {
+				.pass = &p,
+				.row_start = im->height * t / threads,
+				.row_end = im->height * (t + 1) / threads
+			};
+			if (pthread_create(&(tids[t]), NULL, atrous_worker, &(jobs[t])) != 0) {
+				abort("failed to create thread %i\n", t);
+			}
+		}
+		for (int t = 0 ; t < threads ; t++) {
+			pthread_join(tids[t], NULL);
+		}
+
+		for (int ch = 0 ; ch < 3 ; ch++) {
+			float* tmp = p.in[ch];
+			p.in[ch] = p.out[ch];
+			p.out[ch] = tmp;
+		}
+	}
+
+	for (int i = 0 ; i < n ; i++) {
+		im->data[i] = float2color(p.in[0][i], p.in[1][i], p.in[2][i]);
+	}
+
+	if (opts.scratch == NULL) {
+		free_arena(scratch);
+	}
+}
@@ -0,0 +1,37 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This file implements an edge avoiding a-trous wavelet filter (Dammertz et
+ * al, "Edge-Avoiding A-Trous Wavelet Transform for fast Global Illumination
+ * Filtering", 2010). It smooths out sampling noise in a rendered image while
+ * keeping edges sharp, using the normal and depth of the first hit at each
+ * pixel (see gbuffer in render.h) to tell where the edges are.
+ *
+ * This lets us render with far fewer samples per pixel for the same quality.
+ */
+
+#ifndef DENOISE_H
+#define DENOISE_H
+
+#include "util.h"
+#include "render.h"
+
+typedef struct {
+	int iterations;		/* the filter reaches 2^(iterations+1) pixels out */
+	float sigma_color;	/* larger blurs across bigger color differences */
+	float sigma_depth;	/* larger blurs across bigger relative depth changes */
+	int threads;		/* 0 for one per online CPU */
+	arena* scratch;		/* working buffers, NULL to make a temporary one */
+} denoise_opts;
+
+denoise_opts denoise_defaults(void);
+
+/* filters im in place, gb must be the same size as im. Working buffers are
+ * taken from opts.scratch and not given back, the caller should reset it
+ * once per frame. */
+void denoise_image(image* im, gbuffer* gb, denoise_opts opts);
+
+#endif /* DENOISE_H */
@@ -0,0 +1,101 @@
+#include "util.h"
+#include "ray.h"
+#include "vec.h"
+#include "hit.h"
+#include "camera.h"
+#include "render.h"
+#include "denoise.h"
+
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This is not from the book. It renders the Listing 29 scene with simple
+ * diffuse materials (as in the Diffuse Materials chapter), which makes for a
+ * noisy image at low sample counts, then cleans it up with the filter in
+ * denoise.h. A high sample count render is made too, for comparison.
+ */
+
+double rmse(image* a, image* b) {
+	double sum = 0;
+	for (int i = 0 ; i < (a->width * a->height) ; i++) {
+		double dr = a->data[i].r - b->data[i].r;
+		double dg = a->data[i].g - b->data[i].g;
+		double db = a->data[i].b - b->data[i].b;
+		sum += dr * dr + dg * dg + db * db;
+	}
+	return sqrt(sum / (3.0 * a->width * a->height));
+}
+
+int main(void) {
+	const int image_width = 400;
+	const int image_height = 200;
+	const int reference_samples = 100;
+	const int samples_per_pixel = 16;
+
+	image* ref = alloc_image(image_width, image_height, (color) {.r = 0, .g = 0, .b = 0});
+	image* im = alloc_image(image_width, image_height, (color) {.r = 0, .g = 0, .b = 0});
+	gbuffer* gb = alloc_gbuffer(image_width, image_height);
+
+	hitobj world[3];
+	world[0] = (hitobj) {
+		.type = HITTABLE_SPHERE,
+		.center = vec3make(0, 0, -1),
+		.radius = 0.5
+	};
+	world[1] = (hitobj) {
+		.type = HITTABLE_SPHERE,
+		.center = vec3make(0, -100.5, -1),
+		.radius = 100
+	};
+	world[2].type = HITTABLE_NULL;
+
+	scene sc = (scene) {
+		.cam = (camera) {
+			.lower_left_corner = vec3make(-2, -1, -1),
+			.horizontal = vec3make(4, 0, 0),
+			.vertical = vec3make(0, 2, 0),
+			.origin = vec3make(0, 0, 0)
+		},
+		.world = &(world[0]),
+		.ray_color = ray_color_diffuse
+	};
+
+	/* the reference gets its own random numbers, so that its noise is not
+	 * correlated with the low sample count render's */
+	accum* acc = alloc_accum(image_width, image_height);
+	acc->rng = rng_seed(1);
+	double start = render_clock();
+	render_pass(&sc, acc, reference_samples);
+	accum_to_image(acc, ref);
+	double ref_time = render_clock() - start;
+	free_accum(acc);
+
+	start = render_clock();
+	render(&sc, im, samples_per_pixel);
+	double render_time = render_clock() - start;
+	double noisy_err = rmse(im, ref);
+
+	denoise_opts opts = denoise_defaults();
+	opts.scratch = alloc_arena(0, ARENA_HUGEPAGES);
+	start = render_clock();
+	render_gbuffer(&sc, gb);
+	denoise_image(im, gb, opts);
+	double denoise_time = render_clock() - start;
+
+	printf("%i samples per pixel: %.2fs\n", reference_samples, ref_time);
+	printf("%i samples per pixel: %.2fs, RMSE %.2f\n",
+			samples_per_pixel, render_time, noisy_err);
+	printf("%i samples per pixel + denoise: %.2fs, RMSE %.2f\n",
+			samples_per_pixel, render_time + denoise_time, rmse(im, ref));
+	printf("denoiser scratch high water: %zu bytes\n",
+			arena_high_water(opts.scratch));
+	free_arena(opts.scratch);
+
+	write_image(im, OUTFILE);
+	free_gbuffer(gb);
+	free_image(im);
+	free_image(ref);
+}
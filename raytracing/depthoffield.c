@@ -0,0 +1,91 @@
+#include "raytrace.h"
+
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This is not from the book. It renders three spheres at different distances
+ * with a thin lens camera focused on the middle one, using the ray generator
+ * in camera.h. It also times how long it takes to make the rays for a frame
+ * with camera_get_ray() compared to a raygen.
+ */
+
+int main(void) {
+	const int image_width = 400;
+	const int image_height = 200;
+	const int samples_per_pixel = 32;
+	const double focus_distance = 2;
+
+	image* im = alloc_image(image_width, image_height, (color) {.r = 0, .g = 0, .b = 0});
+
+	hitobj world[5];
+	for (int i = 0 ; i < 3 ; i++) {
+		world[i] = (hitobj) {
+			.type = HITTABLE_SPHERE,
+			.center = vec3make(-1.2 + 1.2 * i, 0, -1 - i),
+			.radius = 0.5
+		};
+	}
+	world[3] = (hitobj) {
+		.type = HITTABLE_SPHERE,
+		.center = vec3make(0, -100.5, -1),
+		.radius = 100
+	};
+	world[4].type = HITTABLE_NULL;
+
+	/* the Listing 29 camera, with the image plane pushed out to the focus
+	 * distance */
+	camera cam = (camera) {
+		.lower_left_corner = vec3mult(vec3make(-2, -1, -1), focus_distance),
+		.horizontal = vec3mult(vec3make(4, 0, 0), focus_distance),
+		.vertical = vec3mult(vec3make(0, 2, 0), focus_distance),
+		.origin = vec3make(0, 0, 0),
+		.lens_radius = 0.1
+	};
+
+	/* make every ray for a frame both ways, and keep a running sum so that
+	 * none of the work can be skipped */
+	rngstate rng = rng_seed(0);
+	double checksum = 0;
+	double start = render_clock();
+	for (int row = 0 ; row < image_height ; row++) {
+		for (int col = 0 ; col < image_width ; col++) {
+			for (int s = 0 ; s < samples_per_pixel ; s++) {
+				double u = (col + drand_r(&rng)) / image_width;
+				double v = (row + drand_r(&rng)) / image_height;
+				checksum += camera_get_ray(cam, u, v).direction.x;
+			}
+		}
+	}
+	double get_ray_time = render_clock() - start;
+
+	cam.lens_radius = 0;
+	raygen g = raygen_make(cam, image_width, image_height);
+	raybatch* batch = alloc_raybatch(image_width * samples_per_pixel);
+	start = render_clock();
+	for (int row = 0 ; row < image_height ; row++) {
+		raygen_row(&g, row, 0, image_width, samples_per_pixel, &rng, batch);
+		checksum += batch->dx[batch->count - 1];
+	}
+	double raygen_time = render_clock() - start;
+	free_raybatch(batch);
+
+	double rays = 1.0 * image_width * image_height * samples_per_pixel;
+	printf("camera_get_ray(): %.1f Mrays/s\n", rays / get_ray_time / 1e6);
+	printf("raygen_row(): %.1f Mrays/s\n", rays / raygen_time / 1e6);
+	printf("(checksum %f)\n", checksum);
+
+	cam.lens_radius = 0.1;
+	scene sc = (scene) {
+		.cam = cam,
+		.world = &(world[0]),
+		.ray_color = ray_color_normals
+	};
+	render(&sc, im, samples_per_pixel);
+	printf("DONE\n");
+
+	write_image(im, OUTFILE);
+	free_image(im);
+}
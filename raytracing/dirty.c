@@ -0,0 +1,211 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ */
+
+#include "dirty.h"
+
+#include <string.h>
+
+incremental* alloc_incremental(scene* sc, image* im, int samples_per_pixel) {
+	int n = im->width * im->height;
+	incremental* inc = malloc(sizeof(incremental));
+	inc->sc = *sc;
+	inc->acc = alloc_accum(im->width, im->height);
+	inc->im = im;
+	inc->ids = malloc(sizeof(int32_t) * n);
+	inc->mask = malloc(n);
+	inc->prev = NULL;
+	inc->nprev = 0;
+	inc->samples_per_pixel = samples_per_pixel;
+	inc->rendered = false;
+	return inc;
+}
+
+void free_incremental(incremental* inc) {
+	free_accum(inc->acc);
+	free(inc->ids);
+	free(inc->mask);
+	free(inc->prev);
+	free(inc);
+}
+
+static bool hitobj_same(hitobj a, hitobj b) {
+	if (a.type != b.type) {
+		return false;
+	} else if (a.type == HITTABLE_SPHERE) {
+		return (a.center.x == b.center.x) && (a.center.y == b.center.y) &&
+			(a.center.z == b.center.z) && (a.radius == b.radius);
+	} else if (a.type == HITTABLE_BVH) {
+		return a.bvh == b.bvh;
+	} else if (a.type == HITTABLE_INSTANCE) {
+		return a.instance == b.instance;
+	}
+	return true;
+}
+
+static bool camera_same(camera a, camera b) {
+	return memcmp(&a, &b, sizeof(camera)) == 0;
+}
+
+/* finds the (u, v) at which p appears on screen, returns false if p is not
+ * in front of the camera. Assumes horizontal and vertical are perpendicular,
+ * as they are for every camera in this directory. */
+static bool project(camera cam, vec3 p, double* u, double* v) {
+	vec3 d = vec3sub(p, cam.origin);
+	vec3 corner = vec3sub(cam.lower_left_corner, cam.origin);
+	vec3 n = vec3cross(cam.horizontal, cam.vertical);
+	double dn = vec3dot(d, n);
+	double cn = vec3dot(corner, n);
+
+	if ((dn == 0) || ((dn > 0) != (cn > 0))) {
+		return false;
+	}
+
+	/* scale d out to the image plane */
+	vec3 q = vec3sub(vec3mult(d, cn / dn), corner);
+	*u = vec3dot(q, cam.horizontal) / vec3lensq(cam.horizontal);
+	*v = vec3dot(q, cam.vertical) / vec3lensq(cam.vertical);
+	return true;
+}
+
+/* marks every pixel that h could cover, or every pixel if that can't be
+ * worked out */
+static void mark_bounds(incremental* inc, hitobj h) {
+	int width = inc->im->width;
+	int height = inc->im->height;
+	aabb box = hitbounds(h);
+	double umin = INFINITY, umax = -INFINITY;
+	double vmin = INFINITY, vmax = -INFINITY;
+
+	for (int i = 0 ; i < 8 ; i++) {
+		double u, v;
+		vec3 corner = vec3make(
+			(i & 1) ? box.max.x : box.min.x,
+			(i & 2) ? box.max.y : box.min.y,
+			(i & 4) ? box.max.z : box.min.z);
+		if (!project(inc->sc.cam, corner, &u, &v)) {
+			memset(inc->mask, 1, width * height);
+			return;
+		}
+		umin = fmin(umin, u);
+		umax = fmax(umax, u);
+		vmin = fmin(vmin, v);
+		vmax = fmax(vmax, v);
+	}
+
+	/* pixel (row, col) takes samples from u in [col, col+1) / width and
+	 * likewise for v, pad by a pixel to be safe against rounding */
+	int col0 = fmax(floor(umin * width) - 1, 0);
+	int col1 = fmin(floor(umax * width) + 1, width - 1);
+	int row0 = fmax(floor(vmin * height) - 1, 0);
+	int row1 = fmin(floor(vmax * height) + 1, height - 1);
+
+	for (int row = row0 ; row <= row1 ; row++) {
+		for (int col = col0 ; col <= col1 ; col++) {
+			inc->mask[row * width + col] = 1;
+		}
+	}
+}
+
+/* marks every pixel whose first hit was the object at index id */
+static void mark_id(incremental* inc, int32_t id) {
+	for (int i = 0 ; i < (inc->im->width * inc->im->height) ; i++) {
+		if (inc->ids[i] == id) {
+			inc->mask[i] = 1;
+		}
+	}
+}
+
+static int32_t first_hit_id(hitobj* world, ray r) {
+	hitrec rec;
+	int32_t id = DIRTY_NO_HIT;
+	double closest = INFINITY;
+
+	for (int i = 0 ; world[i].type != HITTABLE_NULL ; i++) {
+		if (hit(world[i], r, 0, closest, &rec)) {
+			closest = rec.t;
+			id = i;
+		}
+	}
+
+	return id;
+}
+
+int incremental_render(incremental* inc, hitobj* world, camera cam) {
+	int width = inc->im->width;
+	int height = inc->im->height;
+	int n = 0;
+
+	while (world[n].type != HITTABLE_NULL) { n++; }
+
+	if (!inc->rendered || !camera_same(cam, inc->sc.cam)) {
+		memset(inc->mask, 1, width * height);
+	} else {
+		memset(inc->mask, 0, width * height);
+		int most = (n > inc->nprev) ? n : inc->nprev;
+		for (int i = 0 ; i < most ; i++) {
+			bool in_old = i < inc->nprev;
+			bool in_new = i < n;
+			if (in_old && in_new && hitobj_same(inc->prev[i], world[i])) {
+				continue;
+			}
+			/* where it was, and where it is now */
+			if (in_old) {
+				mark_bounds(inc, inc->prev[i]);
+				mark_id(inc, i);
+			}
+			if (in_new) {
+				mark_bounds(inc, world[i]);
+			}
+		}
+	}
+
+	inc->sc.cam = cam;
+	inc->sc.world = world;
+	inc->acc->samples = inc->samples_per_pixel;
+
+	/* one ray generator for the whole frame, and each run of marked
+	 * pixels in a row rendered together */
+	raygen g = raygen_make(cam, width, height);
+	int rendered = 0;
+	for (int row = 0 ; row < height ; row++) {
+		size_t start = (size_t) row * width;
+		for (int col = 0 ; col < width ; ) {
+			if (!inc->mask[start + col]) {
+				col++;
+				continue;
+			}
+			int end = col;
+			while ((end < width) && inc->mask[start + end]) {
+				inc->ids[start + end] = first_hit_id(world,
+						raygen_ray(&g, end + 0.5, row + 0.5, NULL));
+				inc->acc->sum[start + end] = vec3make(0, 0, 0);
+				end++;
+			}
+
+			render_span(&(inc->sc), &g, inc->acc->batch, inc->acc,
+					row, col, end - col, inc->samples_per_pixel,
+					&(inc->acc->sum[start + col]));
+			for ( ; col < end ; col++) {
+				vec3 sum = vec3div(inc->acc->sum[start + col],
+						inc->samples_per_pixel);
+				*pix(inc->im, row, col) = float2color(sum.x, sum.y, sum.z);
+				rendered++;
+			}
+		}
+	}
+
+	inc->prev = realloc(inc->prev, sizeof(hitobj) * (n + 1));
+	memcpy(inc->prev, world, sizeof(hitobj) * (n + 1));
+	inc->nprev = n;
+	inc->rendered = true;
+
+	return rendered;
+}
+
+int32_t incremental_pick(incremental* inc, int row, int col) {
+	return inc->ids[row * inc->im->width + col];
+}
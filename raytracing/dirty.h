@@ -0,0 +1,59 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This file implements incremental re-rendering. It remembers the world as it
+ * was at the last render, and when objects are added, removed or moved, only
+ * the pixels that the changed objects covered before or cover now are
+ * rendered again. Every other pixel is left exactly as it was.
+ *
+ * Objects are identified by their index in the world array, and only the
+ * top level of the world is compared, so a change inside of a BVH or to the
+ * geometry of an instance is not noticed unless the hitobj itself changes.
+ *
+ * The screen regions come from the projected bounds of each object, so this
+ * is only exact for shading where a pixel depends only on what it hits first
+ * (such as ray_color_normals()). Shadows and reflections of a moved object
+ * that fall outside of its bounds are not updated.
+ */
+
+#ifndef DIRTY_H
+#define DIRTY_H
+
+#include "util.h"
+#include "hit.h"
+#include "camera.h"
+#include "render.h"
+
+/* value of incremental.ids for a pixel where nothing was hit */
+#define DIRTY_NO_HIT -1
+
+typedef struct {
+	scene sc;
+	accum* acc;
+	image* im;		/* not owned, rendered into */
+	int32_t* ids;		/* world index of the first hit through each pixel centre */
+	uint8_t* mask;		/* 1 for pixels that need rendering again */
+	hitobj* prev;		/* copy of the world as of the last render */
+	int nprev;
+	int samples_per_pixel;
+	bool rendered;		/* false until the first render */
+} incremental;
+
+/* only sc->ray_color is used, the world and camera are given to each call to
+ * incremental_render() */
+incremental* alloc_incremental(scene* sc, image* im, int samples_per_pixel);
+void free_incremental(incremental* inc);
+
+/* Bring im up to date with world, which may be a different array than last
+ * time. The first call renders every pixel, as does any call where the camera
+ * has changed. Returns the number of pixels that were rendered. */
+int incremental_render(incremental* inc, hitobj* world, camera cam);
+
+/* the index of the object visible at the centre of a pixel as of the last
+ * render, or DIRTY_NO_HIT. Useful for picking objects with the mouse. */
+int32_t incremental_pick(incremental* inc, int row, int col);
+
+#endif /* DIRTY_H */
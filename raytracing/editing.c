@@ -0,0 +1,74 @@
+#include "util.h"
+#include "ray.h"
+#include "vec.h"
+#include "hit.h"
+#include "camera.h"
+#include "render.h"
+#include "dirty.h"
+
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This is not from the book. It simulates an interactive editor, where one
+ * sphere is dragged around a scene and only the part of the image around it
+ * is rendered again after each move (see dirty.h).
+ */
+
+#define SPHERES 6
+#define MOVES 5
+
+int main(void) {
+	const int image_width = 400;
+	const int image_height = 200;
+	const int samples_per_pixel = 100;
+
+	image* im = alloc_image(image_width, image_height, (color) {.r = 0, .g = 0, .b = 0});
+
+	camera cam = (camera) {
+		.lower_left_corner = vec3make(-2, -1, -1),
+		.horizontal = vec3make(4, 0, 0),
+		.vertical = vec3make(0, 2, 0),
+		.origin = vec3make(0, 0, 0)
+	};
+
+	hitobj world[SPHERES + 2];
+	for (int i = 0 ; i < SPHERES ; i++) {
+		world[i] = (hitobj) {
+			.type = HITTABLE_SPHERE,
+			.center = vec3make(-1.5 + 0.6 * i, -0.3, -1.5),
+			.radius = 0.2
+		};
+	}
+	world[SPHERES] = (hitobj) {
+		.type = HITTABLE_SPHERE,
+		.center = vec3make(0, -100.5, -1),
+		.radius = 100
+	};
+	world[SPHERES + 1].type = HITTABLE_NULL;
+
+	scene sc = (scene) {.ray_color = ray_color_normals};
+	incremental* inc = alloc_incremental(&sc, im, samples_per_pixel);
+
+	double start = render_clock();
+	int pixels = incremental_render(inc, world, cam);
+	printf("first render: %i pixels in %.2fs\n", pixels, render_clock() - start);
+
+	for (int move = 0 ; move < MOVES ; move++) {
+		world[2].center = vec3sum(world[2].center, vec3make(0.05, 0.1, 0));
+
+		start = render_clock();
+		pixels = incremental_render(inc, world, cam);
+		printf("after move %i: %i pixels in %.2fs\n", move + 1, pixels,
+				render_clock() - start);
+	}
+
+	printf("object where sphere 0 is drawn: %i\n",
+			incremental_pick(inc, image_height * 0.4, image_width / 4));
+
+	write_image(im, OUTFILE);
+	free_incremental(inc);
+	free_image(im);
+}
@@ -6,10 +6,16 @@
  */
 
 #include "hit.h"
+#include "bvh.h"
+#include "instance.h"
 
 bool hit(hitobj h, ray r, double t_min, double t_max, hitrec* rec) {
 	if (h.type == HITTABLE_SPHERE) {
 		return hitsphere(h, r, t_min, t_max, rec);
+	} else if (h.type == HITTABLE_BVH) {
+		return bvh_hit(h.bvh, r, t_min, t_max, rec);
+	} else if (h.type == HITTABLE_INSTANCE) {
+		return instance_hit(h.instance, r, t_min, t_max, rec);
 	} else if (h.type == HITTABLE_NULL) {
 		return false;
 	} else {
@@ -76,3 +82,56 @@ void hitrec_set_face_normal(hitrec* rec, ray r, vec3 outward_normal) {
 	rec->front_face = (vec3dot(r.direction, outward_normal) < 0);
 	rec->normal = rec->front_face ? outward_normal : vec3mult(outward_normal, -1);
 }
+
+aabb hitbounds(hitobj h) {
+	if (h.type == HITTABLE_SPHERE) {
+		vec3 rad = vec3make(h.radius, h.radius, h.radius);
+		return (aabb) {
+			.min = vec3sub(h.center, rad),
+			.max = vec3sum(h.center, rad)
+		};
+	} else if (h.type == HITTABLE_BVH) {
+		return bvh_bounds(h.bvh);
+	} else if (h.type == HITTABLE_INSTANCE) {
+		return instance_bounds(h.instance);
+	} else {
+		abort("no bounds for hittable type %i\n", h.type);
+	}
+}
+
+aabb aabb_union(aabb a, aabb b) {
+	return (aabb) {
+		.min = vec3make(fmin(a.min.x, b.min.x), fmin(a.min.y, b.min.y),
+				fmin(a.min.z, b.min.z)),
+		.max = vec3make(fmax(a.max.x, b.max.x), fmax(a.max.y, b.max.y),
+				fmax(a.max.z, b.max.z))
+	};
+}
+
+vec3 aabb_centroid(aabb box) {
+	return vec3mult(vec3sum(box.min, box.max), 0.5);
+}
+
+bool aabb_hit(aabb box, ray r, vec3 invdir, double t_min, double t_max) {
+	double t0, t1, tmp;
+
+	t0 = (box.min.x - r.origin.x) * invdir.x;
+	t1 = (box.max.x - r.origin.x) * invdir.x;
+	if (t0 > t1) { tmp = t0; t0 = t1; t1 = tmp; }
+	t_min = t0 > t_min ? t0 : t_min;
+	t_max = t1 < t_max ? t1 : t_max;
+
+	t0 = (box.min.y - r.origin.y) * invdir.y;
+	t1 = (box.max.y - r.origin.y) * invdir.y;
+	if (t0 > t1) { tmp = t0; t0 = t1; t1 = tmp; }
+	t_min = t0 > t_min ? t0 : t_min;
+	t_max = t1 < t_max ? t1 : t_max;
+
+	t0 = (box.min.z - r.origin.z) * invdir.z;
+	t1 = (box.max.z - r.origin.z) * invdir.z;
+	if (t0 > t1) { tmp = t0; t0 = t1; t1 = tmp; }
+	t_min = t0 > t_min ? t0 : t_min;
+	t_max = t1 < t_max ? t1 : t_max;
+
+	return t_min <= t_max;
+}
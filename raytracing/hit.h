@@ -22,15 +22,33 @@ typedef struct {
 	bool front_face;
 } hitrec;
 
+/* axis aligned bounding box, used by acceleration structures (see bvh.h) */
+typedef struct {
+	vec3 min;
+	vec3 max;
+} aabb;
+
 /* HITTABLE_NULL is used as a null terminator for arrays/lists of hitobj. 
  * Because null termination is a jolly good idea and we need more of that */
-typedef enum {HITTABLE_NULL=0, HITTABLE_SPHERE} hittable_type;
+typedef enum {HITTABLE_NULL=0, HITTABLE_SPHERE, HITTABLE_BVH,
+	HITTABLE_INSTANCE} hittable_type;
+
+/* defined in bvh.h and instance.h respectively */
+struct bvh_t;
+struct instance_t;
 
-/* note: not all fields are used for all types */
+/* note: not all fields are used for all types. The per-type fields share
+ * storage so that a hitobj stays small no matter how many types there are. */
 typedef struct hitobj_t {
 	hittable_type type;
-	vec3 center;		/* sphere */
-	double radius;		/* sphere */
+	union {
+		struct {
+			vec3 center;		/* sphere */
+			double radius;		/* sphere */
+		};
+		struct bvh_t* bvh;		/* bvh */
+		struct instance_t* instance;	/* instance */
+	};
 } hitobj;
 
 /* rec can be NULL in whih case it will not be populated. If rec is non-null,
@@ -42,4 +60,12 @@ bool hitmany(hitobj* h, ray r, double t_min, double t_max, hitrec* rec);
 bool hitsphere(hitobj h, ray r, double t_min, double t_max, hitrec* rec);
 void hitrec_set_face_normal(hitrec* rec, ray r, vec3 outward_normal);
 
+/* world space bounds of a single object */
+aabb hitbounds(hitobj h);
+aabb aabb_union(aabb a, aabb b);
+vec3 aabb_centroid(aabb box);
+
+/* slab test, invdir is the componentwise reciprocal of r.direction */
+bool aabb_hit(aabb box, ray r, vec3 invdir, double t_min, double t_max);
+
 #endif /* HIT_H */
@@ -0,0 +1,173 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ */
+
+#include "instance.h"
+
+xform xform_identity(void) {
+	return (xform) {.m = {
+		{1, 0, 0, 0},
+		{0, 1, 0, 0},
+		{0, 0, 1, 0}
+	}};
+}
+
+xform xform_translate(vec3 offset) {
+	return (xform) {.m = {
+		{1, 0, 0, offset.x},
+		{0, 1, 0, offset.y},
+		{0, 0, 1, offset.z}
+	}};
+}
+
+xform xform_scale(vec3 factor) {
+	return (xform) {.m = {
+		{factor.x, 0, 0, 0},
+		{0, factor.y, 0, 0},
+		{0, 0, factor.z, 0}
+	}};
+}
+
+xform xform_rotate_y(double degrees) {
+	double theta = deg2rad(degrees);
+	double s = sin(theta);
+	double c = cos(theta);
+	return (xform) {.m = {
+		{c, 0, s, 0},
+		{0, 1, 0, 0},
+		{-s, 0, c, 0}
+	}};
+}
+
+xform xform_compose(xform outer, xform inner) {
+	xform x;
+	for (int row = 0 ; row < 3 ; row++) {
+		for (int col = 0 ; col < 4 ; col++) {
+			x.m[row][col] = outer.m[row][0] * inner.m[0][col] +
+				outer.m[row][1] * inner.m[1][col] +
+				outer.m[row][2] * inner.m[2][col];
+		}
+		x.m[row][3] += outer.m[row][3];
+	}
+	return x;
+}
+
+xform xform_invert(xform x) {
+	double (*m)[4] = x.m;
+	xform inv;
+
+	/* inverse of the linear part by cofactors */
+	inv.m[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	inv.m[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+	inv.m[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+	inv.m[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	inv.m[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+	inv.m[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+	inv.m[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	inv.m[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+	inv.m[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+	double det = m[0][0] * inv.m[0][0] + m[0][1] * inv.m[1][0] +
+		m[0][2] * inv.m[2][0];
+	if (det == 0) {
+		abort("transform is not invertible\n%s", "");
+	}
+
+	for (int row = 0 ; row < 3 ; row++) {
+		for (int col = 0 ; col < 3 ; col++) {
+			inv.m[row][col] /= det;
+		}
+	}
+
+	/* the translation is undone after the linear part is */
+	for (int row = 0 ; row < 3 ; row++) {
+		inv.m[row][3] = -(inv.m[row][0] * m[0][3] +
+			inv.m[row][1] * m[1][3] + inv.m[row][2] * m[2][3]);
+	}
+
+	return inv;
+}
+
+vec3 xform_point(xform x, vec3 p) {
+	return (vec3) {
+		.x = x.m[0][0] * p.x + x.m[0][1] * p.y + x.m[0][2] * p.z + x.m[0][3],
+		.y = x.m[1][0] * p.x + x.m[1][1] * p.y + x.m[1][2] * p.z + x.m[1][3],
+		.z = x.m[2][0] * p.x + x.m[2][1] * p.y + x.m[2][2] * p.z + x.m[2][3]
+	};
+}
+
+vec3 xform_vector(xform x, vec3 v) {
+	return (vec3) {
+		.x = x.m[0][0] * v.x + x.m[0][1] * v.y + x.m[0][2] * v.z,
+		.y = x.m[1][0] * v.x + x.m[1][1] * v.y + x.m[1][2] * v.z,
+		.z = x.m[2][0] * v.x + x.m[2][1] * v.y + x.m[2][2] * v.z
+	};
+}
+
+instance instance_make(hitobj geometry, xform to_world) {
+	return (instance) {
+		.geometry = geometry,
+		.to_world = to_world,
+		.to_object = xform_invert(to_world)
+	};
+}
+
+hitobj instance_hitobj(instance* inst) {
+	return (hitobj) {.type = HITTABLE_INSTANCE, .instance = inst};
+}
+
+bool instance_hit(instance* inst, ray r, double t_min, double t_max, hitrec* rec) {
+	hitrec temprec;
+
+	/* the direction is not re-normalized, so t means the same thing in
+	 * both spaces and no conversion of t_min, t_max or the result is
+	 * needed */
+	ray local = raymake(xform_point(inst->to_object, r.origin),
+			xform_vector(inst->to_object, r.direction));
+
+	if (!hit(inst->geometry, local, t_min, t_max, &temprec)) {
+		return false;
+	}
+
+	if (rec != NULL) {
+		/* normals transform by the inverse transpose of to_world,
+		 * which is the transpose of to_object */
+		double (*m)[4] = inst->to_object.m;
+		vec3 n = temprec.normal;
+		rec->t = temprec.t;
+		rec->p = rayat(r, temprec.t);
+		rec->normal = vec3unit((vec3) {
+			.x = m[0][0] * n.x + m[1][0] * n.y + m[2][0] * n.z,
+			.y = m[0][1] * n.x + m[1][1] * n.y + m[2][1] * n.z,
+			.z = m[0][2] * n.x + m[1][2] * n.y + m[2][2] * n.z
+		});
+		/* the transform preserves which side of the surface the ray
+		 * came from */
+		rec->front_face = temprec.front_face;
+	}
+
+	return true;
+}
+
+aabb instance_bounds(instance* inst) {
+	aabb local = hitbounds(inst->geometry);
+	aabb box;
+
+	for (int i = 0 ; i < 8 ; i++) {
+		vec3 corner = vec3make(
+			(i & 1) ? local.max.x : local.min.x,
+			(i & 2) ? local.max.y : local.min.y,
+			(i & 4) ? local.max.z : local.min.z);
+		corner = xform_point(inst->to_world, corner);
+		if (i == 0) {
+			box = (aabb) {.min = corner, .max = corner};
+		} else {
+			box = aabb_union(box, (aabb) {.min = corner, .max = corner});
+		}
+	}
+
+	return box;
+}
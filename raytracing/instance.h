@@ -0,0 +1,46 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This file implements geometry instancing. An instance places a piece of
+ * shared geometry (usually a BVH, see bvh.h) into the world with an affine
+ * transform. Rather than moving the geometry, rays are moved into the
+ * geometry's object space when they are traced, so any number of instances
+ * can share the same geometry.
+ */
+
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "util.h"
+#include "hit.h"
+
+/* affine transform, the last column is the translation */
+typedef struct {
+	double m[3][4];
+} xform;
+
+typedef struct instance_t {
+	hitobj geometry;	/* shared, not owned by the instance */
+	xform to_world;
+	xform to_object;	/* inverse of to_world */
+} instance;
+
+xform xform_identity(void);
+xform xform_translate(vec3 offset);
+xform xform_scale(vec3 factor);
+xform xform_rotate_y(double degrees);
+/* returns a transform which applies inner, then outer */
+xform xform_compose(xform outer, xform inner);
+xform xform_invert(xform x);
+vec3 xform_point(xform x, vec3 p);
+vec3 xform_vector(xform x, vec3 v);
+
+instance instance_make(hitobj geometry, xform to_world);
+hitobj instance_hitobj(instance* inst);
+bool instance_hit(instance* inst, ray r, double t_min, double t_max, hitrec* rec);
+aabb instance_bounds(instance* inst);
+
+#endif /* INSTANCE_H */
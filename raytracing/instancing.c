@@ -0,0 +1,132 @@
+#include "util.h"
+#include "ray.h"
+#include "vec.h"
+#include "hit.h"
+#include "camera.h"
+#include "bvh.h"
+#include "instance.h"
+
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This is not from the book. It renders a field of identical clusters of
+ * spheres using geometry instancing (see instance.h) and a two level BVH (see
+ * bvh.h), so memory use depends on the size of one cluster rather than on the
+ * number of clusters.
+ */
+
+#define CLUSTER_SPHERES 200
+#define GRID_SIZE 50
+
+vec3 ray_color(ray r, hitobj* world) {
+	hitrec rec;
+	if (hitmany(world, r, 0, INFINITY, &rec)) {
+		return vec3make (
+			0.5 * (rec.normal.x + 1),
+			0.5 * (rec.normal.y + 1),
+			0.5 * (rec.normal.z + 1)
+		);
+	}
+
+	vec3 unit_direction = vec3unit(r.direction);
+	double t = 0.5 * (unit_direction.y + 1.0);
+	return vec3make (
+		(1.0-t) + t * 0.5,
+		(1.0-t) + t * 0.7,
+		(1.0-t) + t * 1.0
+	);
+}
+
+int main(void) {
+	const int image_width = 400;
+	const int image_height = 200;
+	const int samples_per_pixel = 16;
+
+	image* im = alloc_image(image_width, image_height, (color) {.r = 0, .g = 0, .b = 0});
+
+	camera cam = (camera) {
+		.lower_left_corner = vec3make(-2, 1.2, 2),
+		.horizontal = vec3make(4, 0, 0),
+		.vertical = vec3make(0, 2, 0),
+		.origin = vec3make(0, 3, 3)
+	};
+
+	/* the shared geometry: a bunch of small spheres inside of a unit
+	 * sphere, sitting on y=0 */
+	hitobj cluster[CLUSTER_SPHERES + 1];
+	for (int i = 0 ; i < CLUSTER_SPHERES ; i++) {
+		vec3 p;
+		do {
+			p = vec3make(2 * drand() - 1, 2 * drand() - 1, 2 * drand() - 1);
+		} while (vec3lensq(p) > 1);
+		cluster[i] = (hitobj) {
+			.type = HITTABLE_SPHERE,
+			.center = vec3sum(vec3mult(p, 0.35), vec3make(0, 0.4, 0)),
+			.radius = 0.02 + 0.04 * drand()
+		};
+	}
+	cluster[CLUSTER_SPHERES].type = HITTABLE_NULL;
+	bvh* blas = bvh_build(cluster);
+
+	/* place copies of it on a grid, each with its own rotation and
+	 * scale */
+	instance* instances = malloc(sizeof(instance) * GRID_SIZE * GRID_SIZE);
+	hitobj* placed = malloc(sizeof(hitobj) * (GRID_SIZE * GRID_SIZE + 1));
+	for (int i = 0 ; i < GRID_SIZE * GRID_SIZE ; i++) {
+		double x = (i % GRID_SIZE) - GRID_SIZE / 2;
+		double z = -1.0 - (i / GRID_SIZE);
+		double s = 0.6 + 0.4 * drand();
+		xform to_world = xform_compose(xform_translate(vec3make(x, 0, z)),
+				xform_compose(xform_rotate_y(360 * drand()),
+					xform_scale(vec3make(s, s, s))));
+		instances[i] = instance_make(bvh_hitobj(blas), to_world);
+		placed[i] = instance_hitobj(&(instances[i]));
+	}
+	placed[GRID_SIZE * GRID_SIZE].type = HITTABLE_NULL;
+	bvh* tlas = bvh_build(placed);
+
+	hitobj world[3];
+	world[0] = bvh_hitobj(tlas);
+	world[1] = (hitobj) {
+		.type = HITTABLE_SPHERE,
+		.center = vec3make(0, -1000, 0),
+		.radius = 1000
+	};
+	world[2].type = HITTABLE_NULL;
+
+	size_t unique = bvh_size(blas);
+	size_t placement = bvh_size(tlas) + sizeof(instance) * GRID_SIZE * GRID_SIZE;
+	size_t flat = sizeof(hitobj) * CLUSTER_SPHERES * GRID_SIZE * GRID_SIZE;
+	printf("%i instances of %i spheres\n", GRID_SIZE * GRID_SIZE, CLUSTER_SPHERES);
+	printf("unique geometry: %zu bytes, placement: %zu bytes\n", unique, placement);
+	printf("a flat copy of every sphere would take %zu bytes\n", flat);
+
+	for (int row = im->height - 1 ; row >= 0; row--) {
+		printf("\rscanlines remaining: %i    ", row);
+		for (int col = 0 ; col < im->width ; col++) {
+			vec3 veccolor = vec3make(0, 0, 0);
+
+			for (int s = 0 ; s < samples_per_pixel; s++) {
+				double u = (1.0 * col + drand()) / im->width;
+				double v = (1.0 * row + drand()) / im->height;
+				ray r = camera_get_ray(cam, u, v);
+				veccolor = vec3sum(veccolor, ray_color(r, &(world[0])));
+			}
+
+			veccolor = vec3div(veccolor, samples_per_pixel);
+			color c = float2color(veccolor.x, veccolor.y, veccolor.z);
+			*pix(im, row, col) = c;
+		}
+	}
+	printf("\nDONE\n");
+
+	write_image(im, OUTFILE);
+	free_image(im);
+	bvh_free(tlas);
+	bvh_free(blas);
+	free(placed);
+	free(instances);
+}
@@ -0,0 +1,65 @@
+#include "util.h"
+#include "ray.h"
+#include "vec.h"
+#include "hit.h"
+#include "camera.h"
+#include "render.h"
+
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This is not from the book. It renders the scene from Listing 29
+ * progressively (see render.h), writing out the image after every pass.
+ *
+ * usage: progressive [seconds] [samples per pixel]
+ *
+ * Rendering stops after the given number of seconds (default 2) or samples
+ * per pixel (default 100), whichever comes first. Either can be 0 to disable
+ * that limit.
+ */
+
+int main(int argc, char** argv) {
+	const int image_width = 400;
+	const int image_height = 200;
+
+	progressive_opts opts = (progressive_opts) {
+		.deadline = (argc > 1) ? atof(argv[1]) : 2,
+		.target_samples = (argc > 2) ? atoi(argv[2]) : 100,
+		.path = OUTFILE,
+		.verbose = true
+	};
+
+	image* im = alloc_image(image_width, image_height, (color) {.r = 0, .g = 0, .b = 0});
+
+	hitobj world[3];
+	world[0] = (hitobj) {
+		.type = HITTABLE_SPHERE,
+		.center = vec3make(0, 0, -1),
+		.radius = 0.5
+	};
+	world[1] = (hitobj) {
+		.type = HITTABLE_SPHERE,
+		.center = vec3make(0, -100.5, -1),
+		.radius = 100
+	};
+	world[2].type = HITTABLE_NULL;
+
+	scene sc = (scene) {
+		.cam = (camera) {
+			.lower_left_corner = vec3make(-2, -1, -1),
+			.horizontal = vec3make(4, 0, 0),
+			.vertical = vec3make(0, 2, 0),
+			.origin = vec3make(0, 0, 0)
+		},
+		.world = &(world[0]),
+		.ray_color = ray_color_normals
+	};
+
+	int samples = render_progressive(&sc, im, opts);
+	printf("DONE with %i samples per pixel\n", samples);
+
+	free_image(im);
+}
@@ -0,0 +1,28 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * Everything in libraytrace.a, for programs that want to render without being
+ * built in this directory. See render.h for where to start.
+ */
+
+#ifndef RAYTRACE_H
+#define RAYTRACE_H
+
+#include "util.h"
+#include "vec.h"
+#include "ray.h"
+#include "hit.h"
+#include "camera.h"
+#include "arena.h"
+#include "bvh.h"
+#include "bvhcache.h"
+#include "instance.h"
+#include "render.h"
+#include "denoise.h"
+#include "world.h"
+#include "dirty.h"
+
+#endif /* RAYTRACE_H */
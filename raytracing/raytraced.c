@@ -0,0 +1,415 @@
+#include "raytrace.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This is not from the book. It is a render daemon built on libraytrace.a,
+ * which takes render jobs over a Unix socket. Recently used worlds are kept
+ * in memory along with their BVH, so repeated jobs on the same world skip
+ * loading and building it.
+ *
+ * usage: raytraced [socket path] [BVH cache directory]
+ *
+ * If a cache directory is given, BVHs are also saved there (see bvhcache.h),
+ * so that they survive the daemon being restarted.
+ *
+ * A job is a single line of space separated fields:
+ *
+ *	<world file> <normals|diffuse> <width> <height> <samples per pixel>
+ *	<origin xyz> <lower left corner xyz> <horizontal xyz> <vertical xyz>
+ *
+ * The reply is "ok <n>\n" followed by an n byte HIF24 image, or
+ * "error <reason>\n". The connection is closed after the reply.
+ *
+ * Each job's buffers come from an arena (see arena.h), and arenas are kept
+ * between jobs, so once the daemon has seen its largest job it no longer
+ * allocates memory for rendering. Jobs bigger than JOB_PIXELS_MAX pixels or
+ * JOB_SAMPLES_MAX samples per pixel are turned away, and a job that still
+ * doesn't fit in memory gets an error rather than killing the daemon.
+ */
+
+#define DEFAULT_SOCKET "raytraced.sock"
+#define CACHE_SIZE 8
+#define REQUEST_MAX 4096
+#define ARENA_POOL_SIZE 8
+
+/* 4096x4096, which needs about 450MB of buffers */
+#define JOB_PIXELS_MAX (4096 * 4096)
+#define JOB_SAMPLES_MAX 65536
+
+typedef struct {
+	char path[PATH_MAX];
+	struct timespec mtime;
+	hitobj* objs;
+	bvh* accel;
+	hitobj world[2];
+	unsigned long last_used;
+	int users;		/* jobs currently rendering this world */
+	bool loading;		/* being loaded, wait on world_cache.loaded */
+	bool cached;		/* false once it is not in the cache, the last
+				 * user frees it */
+} cached_world;
+
+/* Each path is in at most one entry. An entry whose file has changed is
+ * replaced by a new one straight away, and the old one lives on out of the
+ * cache until the jobs still rendering it are done. */
+typedef struct {
+	cached_world* entries[CACHE_SIZE];	/* NULL if unused */
+	unsigned long clock;
+	unsigned long jobs;
+	char* bvh_cache_dir;	/* NULL to not cache BVHs on disk */
+	arena* arenas[ARENA_POOL_SIZE];	/* idle, ready for the next job */
+	int idle_arenas;
+	pthread_mutex_t lock;
+	pthread_cond_t loaded;	/* an entry finished loading */
+} world_cache;
+
+typedef struct {
+	int fd;
+	world_cache* cache;
+} client;
+
+/* called without the lock held, since loading and building a BVH for a big
+ * world can take a long time */
+static bool load_entry(world_cache* cache, cached_world* w) {
+	hitobj* objs = load_world(w->path);
+	if (objs == NULL) {
+		return false;
+	}
+	w->objs = objs;
+	if (cache->bvh_cache_dir != NULL) {
+		w->accel = bvh_build_cached(objs, cache->bvh_cache_dir);
+	} else {
+		w->accel = bvh_build(objs);
+	}
+	w->world[0] = bvh_hitobj(w->accel);
+	w->world[1].type = HITTABLE_NULL;
+	return true;
+}
+
+static void free_entry(cached_world* w) {
+	bvh_free(w->accel);
+	free(w->objs);
+	free(w);
+}
+
+/* Finds or loads the world at path, returns NULL on error. The result must
+ * be given back with release_world(). A job that wants a world which is
+ * still being loaded waits for it, rather than loading it again. */
+static cached_world* acquire_world(world_cache* cache, char* path) {
+	struct stat st;
+	int found;
+	cached_world* w;
+
+	if (stat(path, &st) != 0) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&(cache->lock));
+	for (;;) {
+		cache->clock++;
+		found = -1;
+		for (int i = 0 ; i < CACHE_SIZE ; i++) {
+			if ((cache->entries[i] != NULL) &&
+					(strcmp(cache->entries[i]->path, path) == 0)) {
+				found = i;
+			}
+		}
+		if ((found < 0) || !cache->entries[found]->loading) {
+			break;
+		}
+		pthread_cond_wait(&(cache->loaded), &(cache->lock));
+	}
+
+	w = (found >= 0) ? cache->entries[found] : NULL;
+	if ((w != NULL) && (w->mtime.tv_sec == st.st_mtim.tv_sec) &&
+			(w->mtime.tv_nsec == st.st_mtim.tv_nsec)) {
+		w->users++;
+		w->last_used = cache->clock;
+		pthread_mutex_unlock(&(cache->lock));
+		return w;
+	}
+
+	/* The file is new or has changed since it was loaded. A changed
+	 * one is replaced in the same slot, otherwise the slot is an empty
+	 * one or else the least recently used idle one. */
+	int slot = found;
+	for (int i = 0 ; (found < 0) && (i < CACHE_SIZE) ; i++) {
+		cached_world* e = cache->entries[i];
+		if (e == NULL) {
+			slot = i;
+			break;
+		}
+		if ((e->users == 0) && ((slot < 0) ||
+				(e->last_used < cache->entries[slot]->last_used))) {
+			slot = i;
+		}
+	}
+
+	w = calloc(1, sizeof(cached_world));
+	snprintf(w->path, sizeof(w->path), "%s", path);
+	w->mtime = st.st_mtim;
+	w->users = 1;
+	w->loading = true;
+	w->last_used = cache->clock;
+
+	/* if every slot is busy, this job gets a copy of its own which is
+	 * thrown away afterwards */
+	cached_world* old = NULL;
+	if (slot >= 0) {
+		old = cache->entries[slot];
+		cache->entries[slot] = w;
+		w->cached = true;
+		if (old != NULL) {
+			old->cached = false;
+			if (old->users > 0) {
+				old = NULL;
+			}
+		}
+	}
+	pthread_mutex_unlock(&(cache->lock));
+
+	if (old != NULL) {
+		free_entry(old);
+	}
+	bool ok = load_entry(cache, w);
+
+	pthread_mutex_lock(&(cache->lock));
+	w->loading = false;
+	if (!ok) {
+		for (int i = 0 ; i < CACHE_SIZE ; i++) {
+			if (cache->entries[i] == w) {
+				cache->entries[i] = NULL;
+			}
+		}
+		free(w);
+		w = NULL;
+	}
+	pthread_cond_broadcast(&(cache->loaded));
+	pthread_mutex_unlock(&(cache->lock));
+	return w;
+}
+
+static void release_world(world_cache* cache, cached_world* w) {
+	pthread_mutex_lock(&(cache->lock));
+	w->users--;
+	bool unused = (w->users == 0) && !w->cached;
+	pthread_mutex_unlock(&(cache->lock));
+	if (unused) {
+		free_entry(w);
+	}
+}
+
+static arena* acquire_arena(world_cache* cache) {
+	arena* a = NULL;
+	pthread_mutex_lock(&(cache->lock));
+	if (cache->idle_arenas > 0) {
+		a = cache->arenas[--cache->idle_arenas];
+	}
+	pthread_mutex_unlock(&(cache->lock));
+	return (a != NULL) ? a : alloc_arena(0, ARENA_HUGEPAGES | ARENA_MAY_FAIL);
+}
+
+static void release_arena(world_cache* cache, arena* a) {
+	arena_reset(a);
+	pthread_mutex_lock(&(cache->lock));
+	if (cache->idle_arenas < ARENA_POOL_SIZE) {
+		cache->arenas[cache->idle_arenas++] = a;
+		a = NULL;
+	}
+	pthread_mutex_unlock(&(cache->lock));
+	if (a != NULL) {
+		free_arena(a);
+	}
+}
+
+static bool write_all(int fd, const void* buf, size_t len) {
+	const char* p = buf;
+	while (len > 0) {
+		ssize_t n = write(fd, p, len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+static void reply_error(int fd, char* reason) {
+	char msg[REQUEST_MAX];
+	snprintf(msg, sizeof(msg), "error %s\n", reason);
+	write_all(fd, msg, strlen(msg));
+}
+
+static void* handle_client(void* arg) {
+	client* c = (client*) arg;
+	char request[REQUEST_MAX];
+	size_t len = 0;
+	char path[PATH_MAX];
+	char shader[32];
+	int width, height, samples;
+	camera cam = {.lens_radius = 0};
+
+	/* read up to the end of the first line */
+	while (len < sizeof(request) - 1) {
+		ssize_t n = read(c->fd, &(request[len]), sizeof(request) - 1 - len);
+		if (n <= 0) {
+			break;
+		}
+		len += n;
+		if (memchr(request, '\n', len) != NULL) {
+			break;
+		}
+	}
+	request[len] = '\0';
+
+	int fields = sscanf(request, "%4095s %31s %i %i %i "
+			"%lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf",
+			path, shader, &width, &height, &samples,
+			&cam.origin.x, &cam.origin.y, &cam.origin.z,
+			&cam.lower_left_corner.x, &cam.lower_left_corner.y,
+			&cam.lower_left_corner.z,
+			&cam.horizontal.x, &cam.horizontal.y, &cam.horizontal.z,
+			&cam.vertical.x, &cam.vertical.y, &cam.vertical.z);
+
+	vec3 (*ray_color)(ray, hitobj*, rngstate*) = NULL;
+	if (fields == 17 && strcmp(shader, "normals") == 0) {
+		ray_color = ray_color_normals;
+	} else if (fields == 17 && strcmp(shader, "diffuse") == 0) {
+		ray_color = ray_color_diffuse;
+	}
+
+	if (fields != 17 || ray_color == NULL) {
+		reply_error(c->fd, "malformed request");
+	} else if (width <= 0 || width > UINT16_MAX || height <= 0 ||
+			height > UINT16_MAX || samples <= 0) {
+		reply_error(c->fd, "bad image size or sample count");
+	} else if ((size_t) width * (size_t) height > JOB_PIXELS_MAX ||
+			samples > JOB_SAMPLES_MAX) {
+		reply_error(c->fd, "image size or sample count too big");
+	} else {
+		cached_world* w = acquire_world(c->cache, path);
+		if (w == NULL) {
+			reply_error(c->fd, "could not load world");
+		} else {
+			scene sc = (scene) {
+				.cam = cam,
+				.world = &(w->world[0]),
+				.ray_color = ray_color
+			};
+
+			/* everything is allocated before rendering, so that
+			 * running out of memory costs nothing but the error */
+			arena* a = acquire_arena(c->cache);
+			accum* acc = alloc_accum_arena(a, width, height);
+			image* im = alloc_image_arena(a, width, height,
+					(color) {.r = 0, .g = 0, .b = 0});
+			uint8_t* buf = (im != NULL) ?
+				arena_alloc(a, hif24_size(im), 0) : NULL;
+
+			if (acc == NULL || im == NULL || buf == NULL) {
+				release_world(c->cache, w);
+				reply_error(c->fd, "out of memory");
+			} else {
+				pthread_mutex_lock(&(c->cache->lock));
+				acc->rng = rng_seed(c->cache->jobs++);
+				pthread_mutex_unlock(&(c->cache->lock));
+
+				render_pass(&sc, acc, samples);
+				accum_to_image(acc, im);
+				release_world(c->cache, w);
+
+				size_t size = hif24_size(im);
+				char header[64];
+				encode_image(im, buf);
+				snprintf(header, sizeof(header), "ok %zu\n", size);
+				if (write_all(c->fd, header, strlen(header))) {
+					write_all(c->fd, buf, size);
+				}
+			}
+
+			release_arena(c->cache, a);
+		}
+	}
+
+	close(c->fd);
+	free(c);
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	char* socket_path = (argc > 1) ? argv[1] : DEFAULT_SOCKET;
+	struct sockaddr_un addr;
+	world_cache cache;
+
+	memset(&cache, 0, sizeof(cache));
+	pthread_mutex_init(&(cache.lock), NULL);
+	pthread_cond_init(&(cache.loaded), NULL);
+	cache.bvh_cache_dir = (argc > 2) ? argv[2] : NULL;
+
+	/* a client going away mid-reply should not take us with it */
+	signal(SIGPIPE, SIG_IGN);
+
+	if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+		abort("socket path '%s' is too long\n", socket_path);
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		abort("failed to create socket: %s\n", strerror(errno));
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socket_path);
+	unlink(socket_path);
+
+	if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+		abort("failed to bind '%s': %s\n", socket_path, strerror(errno));
+	}
+	if (listen(fd, 16) != 0) {
+		abort("failed to listen on '%s': %s\n", socket_path, strerror(errno));
+	}
+
+	printf("listening on %s\n", socket_path);
+	fflush(stdout);
+
+	for (;;) {
+		int cfd = accept(fd, NULL, NULL);
+		if (cfd < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			abort("accept failed: %s\n", strerror(errno));
+		}
+
+		client* c = malloc(sizeof(client));
+		c->fd = cfd;
+		c->cache = &cache;
+
+		pthread_t tid;
+		if (pthread_create(&tid, NULL, handle_client, c) != 0) {
+			close(cfd);
+			free(c);
+			continue;
+		}
+		pthread_detach(tid);
+	}
+}
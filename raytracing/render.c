@@ -0,0 +1,482 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ */
+
+#include "render.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+/* number of frames that can be in flight in render_animation(), one being
+ * rendered while the rest wait for, or are being handled by, the writer */
+#define ANIMATION_SLOTS 2
+
+typedef struct {
+	accum* acc;
+	image* im;
+	uint8_t* encoded;
+	char* path;
+	bool full;		/* rendered and waiting to be written */
+} frame_slot;
+
+typedef struct {
+	frame_slot slots[ANIMATION_SLOTS];
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool done;		/* no more frames will be rendered */
+} frame_pipeline;
+
+accum* alloc_accum(uint16_t width, uint16_t height) {
+	accum* acc = malloc(sizeof(accum));
+	acc->sum = malloc(sizeof(vec3) * width * height);
+	acc->width = width;
+	acc->height = height;
+	acc->rng = rng_seed(0);
+	acc->batch = alloc_raybatch(RENDER_BATCH);
+	accum_clear(acc);
+	return acc;
+}
+
+accum* alloc_accum_arena(arena* a, uint16_t width, uint16_t height) {
+	accum* acc = arena_alloc(a, sizeof(accum), 0);
+	if (acc == NULL) {
+		return NULL;
+	}
+	acc->sum = arena_alloc(a, sizeof(vec3) * width * height, 0);
+	acc->batch = alloc_raybatch_arena(a, RENDER_BATCH);
+	if (acc->sum == NULL || acc->batch == NULL) {
+		return NULL;
+	}
+	acc->width = width;
+	acc->height = height;
+	acc->rng = rng_seed(0);
+	accum_clear(acc);
+	return acc;
+}
+
+void free_accum(accum* acc) {
+	free(acc->sum);
+	free_raybatch(acc->batch);
+	free(acc);
+}
+
+void accum_clear(accum* acc) {
+	for (size_t i = 0 ; i < (size_t) acc->width * acc->height ; i++) {
+		acc->sum[i] = vec3make(0, 0, 0);
+	}
+	acc->samples = 0;
+}
+
+/* depth limit for ray_color_diffuse() */
+#define DIFFUSE_MAX_DEPTH 50
+
+vec3 ray_color_normals(ray r, hitobj* world, rngstate* rng) {
+	hitrec rec;
+	(void) rng;
+
+	if (hitmany(world, r, 0, INFINITY, &rec)) {
+		return vec3make (
+			0.5 * (rec.normal.x + 1),
+			0.5 * (rec.normal.y + 1),
+			0.5 * (rec.normal.z + 1)
+		);
+	}
+
+	vec3 unit_direction = vec3unit(r.direction);
+	double t = 0.5 * (unit_direction.y + 1.0);
+	return vec3make (
+		(1.0-t) + t * 0.5,
+		(1.0-t) + t * 0.7,
+		(1.0-t) + t * 1.0
+	);
+}
+
+static vec3 random_in_unit_sphere(rngstate* rng) {
+	vec3 p;
+	do {
+		p = vec3make(2 * drand_r(rng) - 1, 2 * drand_r(rng) - 1,
+				2 * drand_r(rng) - 1);
+	} while (vec3lensq(p) >= 1);
+	return p;
+}
+
+static vec3 diffuse_color(ray r, hitobj* world, rngstate* rng, int depth) {
+	hitrec rec;
+
+	if (depth <= 0) {
+		return vec3make(0, 0, 0);
+	}
+
+	if (hitmany(world, r, 0.001, INFINITY, &rec)) {
+		vec3 target = vec3sum(vec3sum(rec.p, rec.normal),
+				random_in_unit_sphere(rng));
+		return vec3mult(diffuse_color(raymake(rec.p, vec3sub(target, rec.p)),
+					world, rng, depth - 1), 0.5);
+	}
+
+	vec3 unit_direction = vec3unit(r.direction);
+	double t = 0.5 * (unit_direction.y + 1.0);
+	return vec3make (
+		(1.0-t) + t * 0.5,
+		(1.0-t) + t * 0.7,
+		(1.0-t) + t * 1.0
+	);
+}
+
+vec3 ray_color_diffuse(ray r, hitobj* world, rngstate* rng) {
+	return diffuse_color(r, world, rng, DIFFUSE_MAX_DEPTH);
+}
+
+/* shades the first n rays in batch, adding each run of per_pixel of them to
+ * the next of sums */
+static void shade_batch(scene* sc, accum* acc, raybatch* batch, int n,
+		int per_pixel, vec3* sums) {
+	for (int i = 0 ; i < n ; i++) {
+		ray r = raymake(vec3make(batch->ox[i], batch->oy[i], batch->oz[i]),
+				vec3make(batch->dx[i], batch->dy[i], batch->dz[i]));
+		vec3* sum = &(sums[i / per_pixel]);
+		*sum = vec3sum(*sum, sc->ray_color(r, sc->world, &(acc->rng)));
+	}
+}
+
+void render_span(scene* sc, raygen* g, raybatch* batch, accum* acc, int row,
+		int col, int ncols, int samples_per_pixel, vec3* sums) {
+	if (samples_per_pixel <= batch->capacity) {
+		/* as many whole pixels as fit in the batch at a time */
+		int per_batch = batch->capacity / samples_per_pixel;
+		for (int i = 0 ; i < ncols ; i += per_batch) {
+			int k = (ncols - i < per_batch) ? ncols - i : per_batch;
+			int n = raygen_row(g, row, col + i, k, samples_per_pixel,
+					&(acc->rng), batch);
+			shade_batch(sc, acc, batch, n, samples_per_pixel, &(sums[i]));
+		}
+		return;
+	}
+
+	/* one pixel's samples take several batches */
+	for (int i = 0 ; i < ncols ; i++) {
+		for (int s = 0 ; s < samples_per_pixel ; s += batch->capacity) {
+			int k = samples_per_pixel - s;
+			if (k > batch->capacity) {
+				k = batch->capacity;
+			}
+			int n = raygen_row(g, row, col + i, 1, k, &(acc->rng), batch);
+			shade_batch(sc, acc, batch, n, k, &(sums[i]));
+		}
+	}
+}
+
+/* like render_pass(), but gives up and returns false if the clock passes
+ * stop_at, leaving acc partially updated. A stop_at of 0 never gives up. */
+static bool render_pass_until(scene* sc, accum* acc, int samples_per_pixel, double stop_at) {
+	raygen g = raygen_make(sc->cam, acc->width, acc->height);
+	bool finished = true;
+
+	for (int row = acc->height - 1 ; row >= 0; row--) {
+		if ((stop_at > 0) && (render_clock() > stop_at)) {
+			finished = false;
+			break;
+		}
+
+		render_span(sc, &g, acc->batch, acc, row, 0, acc->width,
+				samples_per_pixel, &(acc->sum[(size_t) row * acc->width]));
+	}
+
+	if (finished) {
+		acc->samples += samples_per_pixel;
+	}
+	return finished;
+}
+
+void render_pass(scene* sc, accum* acc, int samples_per_pixel) {
+	render_pass_until(sc, acc, samples_per_pixel, 0);
+}
+
+void accum_to_image(accum* acc, image* im) {
+	if ((acc->width != im->width) || (acc->height != im->height)) {
+		abort("accumulator is %ix%i but image is %ix%i\n",
+				acc->width, acc->height, im->width, im->height);
+	}
+
+	for (int row = 0 ; row < acc->height ; row++) {
+		for (int col = 0 ; col < acc->width ; col++) {
+			vec3 veccolor = acc->sum[(size_t) row * acc->width + col];
+			if (acc->samples > 0) {
+				veccolor = vec3div(veccolor, acc->samples);
+			}
+			*pix(im, row, col) = float2color(veccolor.x, veccolor.y, veccolor.z);
+		}
+	}
+}
+
+void render(scene* sc, image* im, int samples_per_pixel) {
+	accum* acc = alloc_accum(im->width, im->height);
+	render_pass(sc, acc, samples_per_pixel);
+	accum_to_image(acc, im);
+	free_accum(acc);
+}
+
+/* write to a temporary file and rename it over path, so that path always
+ * holds a complete image even if we are killed part way through writing.
+ * Buffers come from scratch. */
+static void write_image_atomic(image* im, char* path, arena* scratch) {
+	size_t len = strlen(path) + strlen(".tmp") + 1;
+	char* tmp = arena_alloc(scratch, len, 1);
+	snprintf(tmp, len, "%s.tmp", path);
+
+	size_t size = hif24_size(im);
+	uint8_t* buf = arena_alloc(scratch, size, 0);
+	encode_image(im, buf);
+
+	FILE* fp = fopen(tmp, "w");
+	if (fp == NULL) {
+		abort("failed to open '%s' for writing\n", tmp);
+	}
+	fwrite(buf, 1, size, fp);
+	fclose(fp);
+
+	if (rename(tmp, path) != 0) {
+		abort("failed to rename '%s' to '%s'\n", tmp, path);
+	}
+}
+
+int render_progressive(scene* sc, image* im, progressive_opts opts) {
+	if ((opts.target_samples <= 0) && (opts.deadline <= 0)) {
+		abort("need a target sample count, a deadline, or both\n%s", "");
+	}
+
+	/* the accumulators live for the whole render, anything else only
+	 * lasts one pass */
+	arena* frame = alloc_arena(0, 0);
+	arena* scratch = alloc_arena(0, 0);
+	accum* acc = alloc_accum_arena(frame, im->width, im->height);
+	accum* pass = alloc_accum_arena(frame, im->width, im->height);
+	double start = render_clock();
+	double stop_at = (opts.deadline > 0) ? start + opts.deadline : 0;
+	double per_sample = 0;	/* seconds per sample per pixel, measured */
+
+	/* The number of samples per pass doubles each time, so the number of
+	 * intermediate images written is logarithmic in the number of
+	 * samples. Every pass covers the whole frame with independently
+	 * jittered samples, so each pixel is always the unweighted mean of
+	 * the same number of samples, and the image is unbiased no matter
+	 * which pass we stop after. */
+	int pass_samples = 1;
+
+	while ((opts.target_samples <= 0) || (acc->samples < opts.target_samples)) {
+		if ((opts.target_samples > 0) &&
+				(acc->samples + pass_samples > opts.target_samples)) {
+			pass_samples = opts.target_samples - acc->samples;
+		}
+
+		/* after the first pass, don't start one that we don't expect
+		 * to be able to finish */
+		if ((acc->samples > 0) && (stop_at > 0)) {
+			double remaining = stop_at - render_clock();
+			while ((pass_samples > 1) && (per_sample * pass_samples > remaining)) {
+				pass_samples /= 2;
+			}
+			if (per_sample * pass_samples > remaining) {
+				break;
+			}
+		}
+
+		accum_clear(pass);
+		double pass_start = render_clock();
+		if (!render_pass_until(sc, pass, pass_samples,
+					(acc->samples > 0) ? stop_at : 0)) {
+			break;
+		}
+		per_sample = (render_clock() - pass_start) / pass_samples;
+
+		for (size_t i = 0 ; i < (size_t) acc->width * acc->height ; i++) {
+			acc->sum[i] = vec3sum(acc->sum[i], pass->sum[i]);
+		}
+		acc->samples += pass->samples;
+
+		accum_to_image(acc, im);
+		if (opts.path != NULL) {
+			write_image_atomic(im, opts.path, scratch);
+		}
+		arena_reset(scratch);
+
+		if (opts.verbose) {
+			printf("pass done: %i samples per pixel after %.2fs\n",
+					acc->samples, render_clock() - start);
+		}
+
+		pass_samples *= 2;
+	}
+
+	if (opts.verbose) {
+		printf("arena high water: %zu bytes per render, %zu bytes per pass\n",
+				arena_high_water(frame), arena_high_water(scratch));
+	}
+
+	int samples = acc->samples;
+	free_arena(scratch);
+	free_arena(frame);
+	return samples;
+}
+
+static void* frame_writer(void* arg) {
+	frame_pipeline* pl = (frame_pipeline*) arg;
+	int next = 0;
+
+	pthread_mutex_lock(&(pl->lock));
+	for (;;) {
+		frame_slot* slot = &(pl->slots[next]);
+		while (!slot->full && !pl->done) {
+			pthread_cond_wait(&(pl->cond), &(pl->lock));
+		}
+		if (!slot->full) {
+			break;
+		}
+		pthread_mutex_unlock(&(pl->lock));
+
+		accum_to_image(slot->acc, slot->im);
+		encode_image(slot->im, slot->encoded);
+		FILE* fp = fopen(slot->path, "w");
+		if (fp == NULL) {
+			abort("failed to open '%s' for writing\n", slot->path);
+		}
+		fwrite(slot->encoded, 1, hif24_size(slot->im), fp);
+		fclose(fp);
+
+		pthread_mutex_lock(&(pl->lock));
+		slot->full = false;
+		pthread_cond_broadcast(&(pl->cond));
+		next = (next + 1) % ANIMATION_SLOTS;
+	}
+	pthread_mutex_unlock(&(pl->lock));
+
+	return NULL;
+}
+
+void render_animation(scene* sc, camera_key* keys, int nkeys, animation_opts opts) {
+	frame_pipeline pl;
+	pthread_t writer;
+	double start = render_clock();
+	size_t path_len = strlen(opts.path) + 32;
+
+	/* frame times are worked out from the first and last keyframes */
+	if (nkeys <= 0) {
+		abort("camera path has no keyframes\n%s", "");
+	}
+
+	/* every buffer for every slot is made up front, so rendering a frame
+	 * does not allocate at all */
+	arena* slots = alloc_arena(0, ARENA_HUGEPAGES);
+	for (int i = 0 ; i < ANIMATION_SLOTS ; i++) {
+		pl.slots[i].acc = alloc_accum_arena(slots, opts.width, opts.height);
+		pl.slots[i].im = alloc_image_arena(slots, opts.width, opts.height,
+				(color) {.r = 0, .g = 0, .b = 0});
+		pl.slots[i].encoded = arena_alloc(slots, hif24_size(pl.slots[i].im), 0);
+		pl.slots[i].path = arena_alloc(slots, path_len, 1);
+		pl.slots[i].full = false;
+	}
+	pl.done = false;
+	pthread_mutex_init(&(pl.lock), NULL);
+	pthread_cond_init(&(pl.cond), NULL);
+
+	if (pthread_create(&writer, NULL, frame_writer, &pl) != 0) {
+		abort("failed to create writer thread\n%s", "");
+	}
+
+	for (int frame = 0 ; frame < opts.frames ; frame++) {
+		frame_slot* slot = &(pl.slots[frame % ANIMATION_SLOTS]);
+
+		/* wait for the writer to be done with this slot's last frame */
+		pthread_mutex_lock(&(pl.lock));
+		while (slot->full) {
+			pthread_cond_wait(&(pl.cond), &(pl.lock));
+		}
+		pthread_mutex_unlock(&(pl.lock));
+
+		double time = keys[0].time;
+		if (opts.frames > 1) {
+			time += (keys[nkeys-1].time - keys[0].time) * frame / (opts.frames - 1);
+		}
+		sc->cam = camera_path_at(keys, nkeys, time);
+
+		accum_clear(slot->acc);
+		render_pass(sc, slot->acc, opts.samples_per_pixel);
+		snprintf(slot->path, path_len, opts.path, frame);
+
+		pthread_mutex_lock(&(pl.lock));
+		slot->full = true;
+		pthread_cond_broadcast(&(pl.cond));
+		pthread_mutex_unlock(&(pl.lock));
+
+		if (opts.verbose) {
+			printf("rendered frame %i of %i after %.2fs\n", frame + 1,
+					opts.frames, render_clock() - start);
+		}
+	}
+
+	pthread_mutex_lock(&(pl.lock));
+	pl.done = true;
+	pthread_cond_broadcast(&(pl.cond));
+	pthread_mutex_unlock(&(pl.lock));
+	pthread_join(writer, NULL);
+
+	pthread_cond_destroy(&(pl.cond));
+	pthread_mutex_destroy(&(pl.lock));
+	if (opts.verbose) {
+		printf("arena high water: %zu bytes\n", arena_high_water(slots));
+	}
+	free_arena(slots);
+}
+
+gbuffer* alloc_gbuffer(uint16_t width, uint16_t height) {
+	gbuffer* gb = malloc(sizeof(gbuffer));
+	gb->normal = malloc(sizeof(vec3) * width * height);
+	gb->depth = malloc(sizeof(double) * width * height);
+	gb->width = width;
+	gb->height = height;
+	return gb;
+}
+
+void free_gbuffer(gbuffer* gb) {
+	free(gb->normal);
+	free(gb->depth);
+	free(gb);
+}
+
+void render_gbuffer(scene* sc, gbuffer* gb) {
+	hitrec rec;
+	raygen g = raygen_make(sc->cam, gb->width, gb->height);
+	raybatch* batch = alloc_raybatch(RENDER_BATCH);
+
+	for (int row = 0 ; row < gb->height ; row++) {
+		for (int col = 0 ; col < gb->width ; col += batch->capacity) {
+			int n = raygen_row(&g, row, col, gb->width - col, 1, NULL, batch);
+
+			for (int k = 0 ; k < n ; k++) {
+				ray r = raymake(vec3make(batch->ox[k], batch->oy[k], batch->oz[k]),
+						vec3make(batch->dx[k], batch->dy[k], batch->dz[k]));
+				size_t i = (size_t) row * gb->width + col + k;
+
+				if (hitmany(sc->world, r, 0, INFINITY, &rec)) {
+					gb->normal[i] = rec.normal;
+					gb->depth[i] = rec.t * vec3len(r.direction);
+				} else {
+					gb->normal[i] = vec3mult(vec3unit(r.direction), -1);
+					gb->depth[i] = INFINITY;
+				}
+			}
+		}
+	}
+
+	free_raybatch(batch);
+}
+
+double render_clock(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,128 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This file implements a reusable render loop, so that programs only need to
+ * describe a scene rather than each carrying their own copy of the loop.
+ *
+ * It also implements progressive rendering, where the whole frame is rendered
+ * repeatedly at a low number of samples per pixel, and the passes averaged
+ * together. That way there is always a complete image available, and
+ * rendering can stop when a deadline is reached rather than after a fixed
+ * number of samples.
+ */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "util.h"
+#include "vec.h"
+#include "ray.h"
+#include "hit.h"
+#include "camera.h"
+#include "arena.h"
+
+/* rays made at a time by the render loops */
+#define RENDER_BATCH 1024
+
+/* Nothing in here touches global state, so separate renders can run on
+ * separate threads as long as each has its own accum. A scene is only read
+ * from while rendering, so it can be shared between them. */
+
+typedef struct {
+	camera cam;
+	hitobj* world;
+	/* any randomness must come from rng, not drand() */
+	vec3 (*ray_color)(ray r, hitobj* world, rngstate* rng);
+} scene;
+
+/* running sum of every sample taken for each pixel, laid out like image */
+typedef struct {
+	vec3* sum;
+	uint16_t width;
+	uint16_t height;
+	int samples;		/* samples per pixel taken so far */
+	rngstate rng;		/* used for every sample taken into this buffer */
+	raybatch* batch;	/* RENDER_BATCH rays of scratch for render_pass() */
+} accum;
+
+/* what the first hit of the ray through the centre of each pixel looked like,
+ * laid out like image. Used to guide post processing such as denoising (see
+ * denoise.h) */
+typedef struct {
+	vec3* normal;		/* for a miss, points back along the ray */
+	double* depth;		/* distance along the ray, INFINITY for a miss */
+	uint16_t width;
+	uint16_t height;
+} gbuffer;
+
+typedef struct {
+	int target_samples;	/* stop at this many samples per pixel, 0 for no limit */
+	double deadline;	/* stop after this many seconds, 0 for no limit */
+	char* path;		/* if non-NULL, written to after every pass */
+	bool verbose;		/* print progress to standard out */
+} progressive_opts;
+
+typedef struct {
+	uint16_t width;
+	uint16_t height;
+	int frames;		/* spread evenly from the first to the last keyframe */
+	int samples_per_pixel;
+	char* path;		/* printf() format for the frame number, e.g. "f%04i.hif24" */
+	bool verbose;		/* print progress to standard out */
+} animation_opts;
+
+/* shades by surface normal, as in Listing 29 */
+vec3 ray_color_normals(ray r, hitobj* world, rngstate* rng);
+
+/* simple diffuse materials, as in the Diffuse Materials chapter */
+vec3 ray_color_diffuse(ray r, hitobj* world, rngstate* rng);
+
+accum* alloc_accum(uint16_t width, uint16_t height);
+void free_accum(accum* acc);
+
+/* like alloc_accum(), but from the arena a, so it lives until a is reset and
+ * must not be passed to free_accum(). Returns NULL if a ran out of memory
+ * (see ARENA_MAY_FAIL). */
+accum* alloc_accum_arena(arena* a, uint16_t width, uint16_t height);
+void accum_clear(accum* acc);
+
+/* Adds samples_per_pixel samples for each of the ncols pixels from (row, col)
+ * to sums[0] ... sums[ncols-1]. Rays come from g, made a batch at a time by
+ * raygen_row(), and random numbers from acc. g and batch can be reused for
+ * every span of a frame, acc->batch will do for the latter. */
+void render_span(scene* sc, raygen* g, raybatch* batch, accum* acc, int row,
+		int col, int ncols, int samples_per_pixel, vec3* sums);
+
+/* adds samples_per_pixel samples to every pixel of acc */
+void render_pass(scene* sc, accum* acc, int samples_per_pixel);
+
+/* writes the average of all samples so far into im */
+void accum_to_image(accum* acc, image* im);
+
+/* render samples_per_pixel samples for every pixel into im */
+void render(scene* sc, image* im, int samples_per_pixel);
+
+/* Render progressively into im until the target sample count or deadline is
+ * reached, whichever is first. The first pass always runs to completion so
+ * that there is something to show. A pass that would not finish before the
+ * deadline is abandoned, so every pixel always has the same number of
+ * samples. Returns the number of samples per pixel in the final image. */
+int render_progressive(scene* sc, image* im, progressive_opts opts);
+
+/* Render a sequence of frames, moving sc->cam along a camera path. The scene
+ * is reused between frames. Converting, encoding and writing out each frame
+ * happens on a separate thread, at the same time as the next frame is
+ * rendered. */
+void render_animation(scene* sc, camera_key* keys, int nkeys, animation_opts opts);
+
+gbuffer* alloc_gbuffer(uint16_t width, uint16_t height);
+void free_gbuffer(gbuffer* gb);
+void render_gbuffer(scene* sc, gbuffer* gb);
+
+/* seconds since some arbitrary fixed point, for measuring intervals */
+double render_clock(void);
+
+#endif /* RENDER_H */
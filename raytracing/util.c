@@ -1,4 +1,5 @@
 #include "util.h"
+#include "arena.h"
 
 /* Copyright 2020 Charles Daniels
  *
@@ -7,14 +8,37 @@
  * Based on https://raytracing.github.io/
  */
 
-image* alloc_image(uint16_t width, uint16_t height, color def) {
-	image* im = malloc(sizeof(image));
-	im->data = malloc(sizeof(color) * width * height);
+/* fills in im, taking pixel memory from a if it is non-NULL or the heap
+ * otherwise. Returns false if a ran out of memory. */
+static bool init_image(image* im, struct arena_t* a, uint16_t width,
+		uint16_t height, color def) {
+	size_t bytes = sizeof(color) * width * height;
+	im->data = (a != NULL) ? arena_alloc(a, bytes, 0) : malloc(bytes);
 	im->width = width;
 	im->height = height;
-	for (int i = 0 ; i < (width * height) ; i++) {
+	if (im->data == NULL) {
+		return false;
+	}
+	for (size_t i = 0 ; i < (size_t) width * height ; i++) {
 		im->data[i] = def;
 	}
+	return true;
+}
+
+image* alloc_image(uint16_t width, uint16_t height, color def) {
+	image* im = malloc(sizeof(image));
+	if (!init_image(im, NULL, width, height, def)) {
+		abort("failed to allocate a %ix%i image\n", width, height);
+	}
+	return im;
+}
+
+image* alloc_image_arena(struct arena_t* a, uint16_t width, uint16_t height,
+		color def) {
+	image* im = arena_alloc(a, sizeof(image), 0);
+	if ((im == NULL) || !init_image(im, a, width, height, def)) {
+		return NULL;
+	}
 	return im;
 }
 
@@ -27,40 +51,52 @@ void write_image(image* im, char* path) {
 	/* write out an image magic in H2F 24bpp format (HIF24) */
 
 	FILE* fp = fopen(path, "w");
+	if (fp == NULL) {
+		abort("failed to open '%s' for writing\n", path);
+	}
+
+	size_t size = hif24_size(im);
+	uint8_t* buf = malloc(size);
+	encode_image(im, buf);
+	fwrite(buf, 1, size, fp);
+	free(buf);
+
+	fclose(fp);
+}
+
+size_t hif24_size(image* im) {
+	return 16 + 3 * (size_t) im->width * im->height;
+}
 
+void encode_image(image* im, uint8_t* buf) {
 	/* magic bytes */
-	fputc('H', fp);
-	fputc('e', fp);
-	fputc('R', fp);
-	fputc('C', fp);
+	buf[0] = 'H';
+	buf[1] = 'e';
+	buf[2] = 'R';
+	buf[3] = 'C';
 
 	/* size */
-	fputc((im->width & 0xff00) >> 8, fp);
-	fputc((im->width & 0xff), fp);
-	fputc((im->height & 0xff00) >> 8, fp);
-	fputc((im->height & 0xff), fp);
+	buf[4] = (im->width & 0xff00) >> 8;
+	buf[5] = (im->width & 0xff);
+	buf[6] = (im->height & 0xff00) >> 8;
+	buf[7] = (im->height & 0xff);
 
 	/* format 0 = hif24 */
-	fputc(0, fp);
+	buf[8] = 0;
 
 	/* reserved bytes */
-	fputc(0, fp);
-	fputc(0, fp);
-	fputc(0, fp);
-	fputc(0, fp);
-	fputc(0, fp);
-	fputc(0, fp);
-	fputc(0, fp);
+	for (int i = 9 ; i < 16 ; i++) {
+		buf[i] = 0;
+	}
 
+	buf += 16;
 	for (int row = im->height-1 ; row >= 0 ; row--) {
 		for (int col = 0 ; col < im->width ; col++) {
-			fputc(pix(im, row, col)->r, fp);
-			fputc(pix(im, row, col)->g, fp);
-			fputc(pix(im, row, col)->b, fp);
+			*(buf++) = pix(im, row, col)->r;
+			*(buf++) = pix(im, row, col)->g;
+			*(buf++) = pix(im, row, col)->b;
 		}
 	}
-
-	fclose(fp);
 }
 
 color float2color(double r, double g, double b) {
@@ -79,3 +115,8 @@ color float2color(double r, double g, double b) {
 		.b = (uint8_t) (255.99 * b),
 	};
 }
+
+rngstate rng_seed(uint32_t seed) {
+	/* the same layout srand48() uses */
+	return (rngstate) {.xsubi = {0x330e, seed & 0xffff, seed >> 16}};
+}
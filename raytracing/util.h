@@ -29,7 +29,8 @@ typedef struct {
 	uint16_t height;
 } image;
 
-#define pix(_im, _row, _col) (&(_im->data[_row * _im->width + _col]))
+#define pix(_im, _row, _col) \
+	(&((_im)->data[(size_t) (_row) * (_im)->width + (_col)]))
 
 #define abort(fmt, ...) do { \
 		fprintf(stderr, "FATAL: aborted at %s:%i %s(): ", \
@@ -46,9 +47,32 @@ typedef struct {
 	(min + (max - min) * drand())
 #define dclamp(_x_, _min_, _max_) (x < min ? min : x > max ? max : x)
 
+/* drand() shares one global random number generator. Anything that may run
+ * on more than one thread at a time, or that wants repeatable results, should
+ * keep its own rngstate and use drand_r() instead. */
+typedef struct {
+	unsigned short xsubi[3];
+} rngstate;
+
+#define drand_r(_rng_) erand48((_rng_)->xsubi)
+
 image* alloc_image(uint16_t width, uint16_t height, color def);
+
+/* like alloc_image(), but everything comes from the arena a (see arena.h).
+ * The image lives until a is reset, and must not be passed to free_image().
+ * Returns NULL if a ran out of memory (see ARENA_MAY_FAIL). */
+struct arena_t;
+image* alloc_image_arena(struct arena_t* a, uint16_t width, uint16_t height,
+		color def);
 void free_image(image* im);
 void write_image(image* im, char* path);
 color float2color(double r, double g, double b);
+rngstate rng_seed(uint32_t seed);
+
+/* size in bytes of im once encoded as HIF24, including the header */
+size_t hif24_size(image* im);
+
+/* encode im as HIF24 into buf, which must be at least hif24_size(im) bytes */
+void encode_image(image* im, uint8_t* buf);
 
 #endif /* UTIL_H */
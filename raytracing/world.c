@@ -0,0 +1,59 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ */
+
+#include "world.h"
+
+#include <string.h>
+
+hitobj* load_world(char* path) {
+	char line[WORLD_LINE_MAX];
+	int lineno = 0;
+	int count = 0;
+	int capacity = 16;
+
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL) {
+		fprintf(stderr, "%s: could not open for reading\n", path);
+		return NULL;
+	}
+
+	hitobj* objs = malloc(sizeof(hitobj) * capacity);
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		double x, y, z, radius;
+		char kind[32];
+
+		lineno++;
+		if (sscanf(line, "%31s", kind) != 1 || kind[0] == '#') {
+			continue;
+		}
+
+		/* leave room for the null terminator */
+		if (count + 1 >= capacity) {
+			capacity *= 2;
+			objs = realloc(objs, sizeof(hitobj) * capacity);
+		}
+
+		if ((strcmp(kind, "sphere") == 0) &&
+				(sscanf(line, "%*s %lf %lf %lf %lf", &x, &y, &z, &radius) == 4)) {
+			objs[count++] = (hitobj) {
+				.type = HITTABLE_SPHERE,
+				.center = vec3make(x, y, z),
+				.radius = radius
+			};
+		} else {
+			fprintf(stderr, "%s:%i: could not parse '%s'\n", path, lineno, kind);
+			fclose(fp);
+			free(objs);
+			return NULL;
+		}
+	}
+
+	fclose(fp);
+	objs[count].type = HITTABLE_NULL;
+	return objs;
+}
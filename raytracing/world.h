@@ -0,0 +1,29 @@
+/* Copyright 2020 Charles Daniels
+ *
+ * See README.md for license information.
+ *
+ * Based on https://raytracing.github.io/
+ *
+ * This file implements loading a world (a HITTABLE_NULL terminated array of
+ * hitobj) from a text file, so that scenes don't have to be compiled in.
+ *
+ * The file has one object per line, blank lines and lines starting with # are
+ * ignored:
+ *
+ *	sphere <center x> <center y> <center z> <radius>
+ */
+
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "util.h"
+#include "hit.h"
+
+/* the maximum length of a line in a world file */
+#define WORLD_LINE_MAX 1024
+
+/* Returns a malloc()-ed array, or NULL if the file could not be read or
+ * parsed, in which case the reason is printed to standard error. */
+hitobj* load_world(char* path);
+
+#endif /* WORLD_H */